@@ -1,7 +1,7 @@
-﻿/** Thin 5x8 font. */
-#define font(i) standard_font[i-0x20]
+﻿#include "5x8_font.hpp"
 
-const static unsigned char standard_font[] = {
+// Only copy of the font; PROGMEM keeps it in flash instead of being copied to SRAM at start up
+const unsigned char standard_font[] PROGMEM = {
 	0x0,	0x0,	0x0,	0x0,	0x0,	// [0x20] ' '
 	0x0,	0x0,	0x2F,	0x0,	0x0,	// [0x21] '!'
 	0x0,	0x3,	0x0,	0x3,	0x0,	// [0x22] '"'
@@ -97,4 +97,4 @@ const static unsigned char standard_font[] = {
 	0x0,	0x0,	0x7F,	0x0,	0x0,	// [0x7C] '|'
 	0x0,	0x41,	0x36,	0x8,	0x0,	// [0x7D] '}'
 	0x0,	0x2,	0x1,	0x2,	0x1 	// [0x7E] '~'
-};
\ No newline at end of file
+};
@@ -1,101 +1,15 @@
 ﻿/** Thin 5x8 font. */
+#ifndef __5X8_FONT_H__
+#define __5X8_FONT_H__
 
-#define font(i,j) standard_font[(i-0x20)*5+j]
+#include <avr/pgmspace.h>
 
-const static unsigned char standard_font[] = {
-	0x0,	0x0,	0x0,	0x0,	0x0,	// [0x20] ' '
-	0x0,	0x0,	0x2F,	0x0,	0x0,	// [0x21] '!'
-	0x0,	0x3,	0x0,	0x3,	0x0,	// [0x22] '"'
-	0x14,	0x3E,	0x14,	0x3E,	0x14,	// [0x23] '#'
-	0x24,	0x2A,	0x7F,	0x2A,	0x12,	// [0x24] '$'
-	0x22,	0x10,	0x8,	0x4,	0x22,	// [0x25] '%'
-	0x18,	0x24,	0x24,	0x1E,	0x4,	// [0x26] '&'
-	0x0,	0x0,	0x3,	0x0,	0x0,	// [0x27] '''
-	0x0,	0x1C,	0x22,	0x41,	0x0,	// [0x28] '('
-	0x0,	0x41,	0x22,	0x1C,	0x0,	// [0x29] ')'
-	0x2A,	0x1C,	0x3E,	0x1C,	0x2A,	// [0x2A] '*'
-	0x8,	0x8,	0x3E,	0x8,	0x8,	// [0x2B] '+'
-	0x0,	0x40,	0x20,	0x0,	0x0,	// [0x2C] ','
-	0x8,	0x8,	0x8,	0x8,	0x8,	// [0x2D] '-'
-	0x0,	0x0,	0x20,	0x0,	0x0,	// [0x2E] '.'
-	0x0,	0xC0,	0x30,	0xC,	0x3,	// [0x2F] '/'
-	0x1E,	0x29,	0x2D,	0x25,	0x1E,	// [0x30] '0'
-	0x0,	0x22,	0x3F,	0x20,	0x0,	// [0x31] '1'
-	0x32,	0x29,	0x29,	0x29,	0x26,	// [0x32] '2'
-	0x12,	0x21,	0x29,	0x29,	0x16,	// [0x33] '3'
-	0x7,	0x8,	0x8,	0x8,	0x3E,	// [0x34] '4'
-	0x17,	0x25,	0x25,	0x25,	0x18,	// [0x35] '5'
-	0x1E,	0x25,	0x25,	0x25,	0x18,	// [0x36] '6'
-	0x1,	0x1,	0x9,	0x9,	0x3E,	// [0x37] '7'
-	0x1A,	0x25,	0x25,	0x25,	0x1A,	// [0x38] '8'
-	0x6,	0x9,	0x9,	0x9,	0x3E,	// [0x39] '9'
-	0x0,	0x0,	0x22,	0x0,	0x0,	// [0x3A] ':'
-	0x0,	0x40,	0x22,	0x0,	0x0,	// [0x3B] ';'
-	0x0,	0x8,	0x14,	0x22,	0x41,	// [0x3C] '<'
-	0x14,	0x14,	0x14,	0x14,	0x14,	// [0x3D] '='
-	0x0,	0x41,	0x22,	0x14,	0x8,	// [0x3E] '>'
-	0x2,	0x1,	0x29,	0x9,	0x6,	// [0x3F] '?'
-	0x1E,	0x21,	0x2D,	0x2D,	0x6,	// [0x40] '@'
-	0x3E,	0x11,	0x11,	0x11,	0x3E,	// [0x41] 'A'
-	0x3E,	0x25,	0x25,	0x25,	0x1A,	// [0x42] 'B'
-	0x1E,	0x21,	0x21,	0x21,	0x12,	// [0x43] 'C'
-	0x3E,	0x21,	0x21,	0x22,	0x1C,	// [0x44] 'D'
-	0x3F,	0x29,	0x29,	0x21,	0x21,	// [0x45] 'E'
-	0x3F,	0x9,	0x9,	0x1,	0x1,	// [0x46] 'F'
-	0x1E,	0x21,	0x29,	0x29,	0x1A,	// [0x47] 'G'
-	0x3F,	0x8,	0x8,	0x8,	0x3F,	// [0x48] 'H'
-	0x0,	0x21,	0x3F,	0x21,	0x0,	// [0x49] 'I'
-	0x10,	0x20,	0x21,	0x21,	0x1F,	// [0x4A] 'J'
-	0x3F,	0x8,	0xC,	0x12,	0x21,	// [0x4B] 'K'
-	0x1F,	0x20,	0x20,	0x20,	0x20,	// [0x4C] 'L'
-	0x3E,	0x1,	0x6,	0x1,	0x3E,	// [0x4D] 'M'
-	0x3E,	0x1,	0x1,	0x2,	0x3C,	// [0x4E] 'N'
-	0x1E,	0x21,	0x21,	0x21,	0x1E,	// [0x4F] 'O'
-	0x3E,	0x11,	0x11,	0x11,	0xE,	// [0x50] 'P'
-	0x1E,	0x21,	0x29,	0x71,	0x5E,	// [0x51] 'Q'
-	0x3E,	0x9,	0x9,	0x9,	0x36,	// [0x52] 'R'
-	0x12,	0x25,	0x25,	0x25,	0x18,	// [0x53] 'S'
-	0x1,	0x1,	0x3F,	0x1,	0x1,	// [0x54] 'T'
-	0x1F,	0x20,	0x20,	0x20,	0x1F,	// [0x55] 'U'
-	0xF,	0x10,	0x20,	0x10,	0xF,	// [0x56] 'V'
-	0x1F,	0x20,	0x18,	0x20,	0x1F,	// [0x57] 'W'
-	0x31,	0xA,	0x4,	0xA,	0x31,	// [0x58] 'X'
-	0x7,	0x28,	0x28,	0x28,	0x1F,	// [0x59] 'Y'
-	0x31,	0x29,	0x25,	0x23,	0x21,	// [0x5A] 'Z'
-	0x0,	0x7F,	0x41,	0x41,	0x0,	// [0x5B] '['
-	0x0,	0x3,	0xC,	0x30,	0xC0,	// [0x5C] '\\'
-	0x0,	0x41,	0x41,	0x7F,	0x0,	// [0x5D] ']'
-	0x0,	0x2,	0x1,	0x2,	0x0,	// [0x5E] '^'
-	0x40,	0x40,	0x40,	0x40,	0x40,	// [0x5F] '_'
-	0x1,	0x2,	0x0,	0x0,	0x0,	// [0x60] '`'
-	0x1C,	0x22,	0x22,	0x22,	0x3C,	// [0x61] 'a'
-	0x1F,	0x22,	0x22,	0x22,	0x1C,	// [0x62] 'b'
-	0x1C,	0x22,	0x22,	0x22,	0x20,	// [0x63] 'c'
-	0x1C,	0x22,	0x22,	0x22,	0x1F,	// [0x64] 'd'
-	0x1C,	0x2A,	0x2A,	0x2A,	0x4,	// [0x65] 'e'
-	0x8,	0x7E,	0x9,	0x1,	0x1,	// [0x66] 'f'
-	0xC,	0x52,	0x52,	0x52,	0x3C,	// [0x67] 'g'
-	0x3F,	0x2,	0x2,	0x2,	0x3C,	// [0x68] 'h'
-	0x0,	0x0,	0x3D,	0x0,	0x0,	// [0x69] 'i'
-	0x20,	0x40,	0x40,	0x40,	0x3D,	// [0x6A] 'j'
-	0x3F,	0x8,	0x8,	0x14,	0x22,	// [0x6B] 'k'
-	0x0,	0x1F,	0x20,	0x20,	0x0,	// [0x6C] 'l'
-	0x3C,	0x2,	0x4,	0x2,	0x3C,	// [0x6D] 'm'
-	0x3C,	0x2,	0x2,	0x2,	0x3C,	// [0x6E] 'n'
-	0x1C,	0x22,	0x22,	0x22,	0x1C,	// [0x6F] 'o'
-	0x7C,	0x12,	0x12,	0x12,	0xC,	// [0x70] 'p'
-	0xC,	0x12,	0x12,	0x12,	0x7E,	// [0x71] 'q'
-	0x3C,	0x2,	0x2,	0x2,	0x4,	// [0x72] 'r'
-	0x24,	0x2A,	0x2A,	0x2A,	0x10,	// [0x73] 's'
-	0x1F,	0x22,	0x22,	0x20,	0x10,	// [0x74] 't'
-	0x1E,	0x20,	0x20,	0x20,	0x1E,	// [0x75] 'u'
-	0xE,	0x10,	0x20,	0x10,	0xE,	// [0x76] 'v'
-	0x1E,	0x20,	0x10,	0x20,	0x1E,	// [0x77] 'w'
-	0x22,	0x14,	0x8,	0x14,	0x22,	// [0x78] 'x'
-	0xE,	0x50,	0x50,	0x50,	0x3E,	// [0x79] 'y'
-	0x22,	0x32,	0x2A,	0x26,	0x22,	// [0x7A] 'z'
-	0x0,	0x8,	0x36,	0x41,	0x0,	// [0x7B] '{'
-	0x0,	0x0,	0x7F,	0x0,	0x0,	// [0x7C] '|'
-	0x0,	0x41,	0x36,	0x8,	0x0,	// [0x7D] '}'
-	0x0,	0x2,	0x1,	0x2,	0x1 	// [0x7E] '~'
-};
\ No newline at end of file
+#define FONT_WIDTH 5
+
+/** Reads column j of character i from the font in flash */
+#define font(i,j) pgm_read_byte(&standard_font[((i)-0x20)*FONT_WIDTH+(j)])
+
+// Columns of the characters 0x20 to 0x7E, FONT_WIDTH bytes each
+extern const unsigned char standard_font[] PROGMEM;
+
+#endif /* __5X8_FONT_H__ */
\ No newline at end of file
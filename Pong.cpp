@@ -4,122 +4,290 @@
 uint8_t i = 0;
 
 Pong::Pong() :
-	b(), lPad(0), rPad(127), display() {
+	balls(), lPad(0), rPad(127), display()
+#ifdef PONG_AI
+	, ai(127, PONG_AI_LEVEL)
+#endif
+	, state(PONG_SPLASH), timer(0), server(0), quiet(FALSE), shown(0)
+{
+}
+
+void Pong::start() {
+	state = PONG_SPLASH;
+	timer = PONG_TICKS(PONG_SPLASH_MS);
+	showScreen();
+}
+
+uint8_t Pong::countDown(uint8_t steps) {
+	if (timer > steps) {
+		timer -= steps;
+		return FALSE;
+	}
+	timer = 0;
+	return TRUE;
+}
+
+void Pong::update(uint8_t steps) {
+	switch (state) {
+		case PONG_SPLASH:
+			if (countDown(steps)) {
+#ifdef PONG_LINK
+				// Both boards have to pick the same directions, from the pads they agree on
+				uint16_t r = lPad.getY() ^ rPad.getY();
+#else
+				uint16_t r = randVal();
+#endif
+				for (uint8_t i=0; i<Balls::BALLS; i++, r >>= 1) {
+					if (r & 1)
+						balls.revX(i); // Randomize starting direction of balls
+				}
+				state = PONG_PLAY;
+				changeScreen();
+			}
+			break;
+		case PONG_SERVE: {
+			// The balls follow the serving pad
+			uint8_t height = server<0?lPad.getY():rPad.getY();
+			for (uint8_t i=0; i<Balls::BALLS; i++)
+				balls.setY(i, height);
+			if (countDown(steps))
+				serve();
+			break;
+		}
+		default:
+			// Catch up with the ticks that passed, but stop at a point
+			while (steps-- && madePoint(0) == 0)
+				stepBall();
+			if (madePoint(0) != 0)
+				pointMenu();
+	}
+}
+
+uint16_t Pong::padInput(uint8_t pin) {
+#ifdef PONG_AI
+	if (pin == PONG_R_PIN)
+		return ai.update(balls);
+#endif
+	return readADC(pin);
+}
+
+void Pong::stepTick(uint16_t left, uint16_t right) {
+	lPad.setY(left);
+	rPad.setY(right);
+	update(1);
 }
 
 void Pong::refreshPads() {
-	lPad.setY(readADC(PONG_L_PIN)); // [0-255]
-	rPad.setY(readADC(PONG_R_PIN)); // [0-255]
+#ifndef PONG_LINK
+	lPad.setY(padInput(PONG_L_PIN)); // [0-ADC_MAX]
+	rPad.setY(padInput(PONG_R_PIN)); // [0-ADC_MAX]
+#endif
+	if (state == PONG_SPLASH)
+		return;
 	
 	lPad.refresh(display);
 	rPad.refresh(display);
 }
 
 void Pong::stepBall() {
-	b.step();
-	b.bouncePad(lPad);
-	b.bouncePad(rPad);
-	b.touchWalls(*this);
+	balls.stepAll();
+	uint8_t bounced = balls.bounceAll(lPad);
+	bounced += balls.bounceAll(rPad);
+#ifdef PONG_AI
+	if (bounced)
+		ai.event();
+#endif
+	int8_t point = balls.touchWallsAll();
+	if (point)
+		madePoint(point);
 }
 
 void Pong::refreshBall() {
-	point8_t pos;
-	uint8_t sreg_save = SREG;
-	cli();
-	pos.x = b.getX();
-	pos.y = b.getY();
-	SREG = sreg_save;
+	if (state != PONG_SPLASH)
+		balls.refreshAll(display);
+}
 
-	display.clear_pixel(lastPos.x, lastPos.y);
-	display.set_pixel(pos.x, pos.y);
-	display.refresh(lastPos.x, lastPos.y);
-	display.refresh(pos.x, pos.y);
-	lastPos = pos;
+uint16_t Pong::flush() {
+	return display.flush();
 }
 
-void Pong::menu() {
-	display.clear();
-	display.writeStr("Welcome to PONG", 0, 0);
-	display.writeStr("Made by Emaus", 0, 55);
-	display.refresh();	_delay_ms(3000);
-	display.clear();
-	display.refresh();
-	if (randVal() & 1)
-		b.revX(); // Randomize starting direction of ball
+SSD1306& Pong::getDisplay() {
+	return display;
 }
 
-void setSubString(char *str, const char *subStr, uint8_t pos) {
-	for (uint8_t i=0; subStr[i]; i++) {
-		str[i+pos] = subStr[i];
-	}
+uint8_t Pong::getPoints(uint8_t right) {
+	return (right ? rPoints : lPoints) & 0x7F;
+}
+
+void Pong::sendTelemetry(uint16_t tick, uint8_t duty) {
+	telemetry_state_t s;
+	point16_t pos = balls.getPos(0), vel = balls.getVel(0);
+	s.tick = tick;
+	s.ballX = pos.x;
+	s.ballY = pos.y;
+	s.velX = vel.x;
+	s.velY = vel.y;
+	s.spin = balls.getSpin(0);
+	s.padY[0] = lPad.getY();
+	s.padY[1] = rPad.getY();
+	s.padVel[0] = lPad.getVel().getRaw();
+	s.padVel[1] = rPad.getVel().getRaw();
+	s.score[0] = lPoints & 0x7F;
+	s.score[1] = rPoints & 0x7F;
+	s.duty = duty;
+	telemetrySend(TELEMETRY_STATE, &s, sizeof(s));
 }
 
 void Pong::pointMenu() {
 	// Place ball depending on who made the point
 	int8_t p = 0;
+	uint8_t x = 64;
+	ball_vel_t velX = Balls::Physics::INIT_SPEED;
 	if (lPoints & 0x80) {
 		p = -1;
 		lPoints &= 0x7F;
-		b.setX(1);
-		b.setVelX(BALL_INIT_SPEED);
+		x = 1;
 	} else if (rPoints & 0x80) {
 		p = 1;
 		rPoints &= 0x7F;
-		b.setX(126);
-		b.setVelX(-BALL_INIT_SPEED);
-	} else {
-		b.setX(64);
-		b.setVelX(BALL_INIT_SPEED);
-	}
-	
-	display.clear();
-	char scoreStr[] = "Scored by 0     ";
-	#define SCORE_START_POS 10
-	if (p < 0)
-		setSubString(scoreStr, "LEFT!", SCORE_START_POS);
-	else
-		setSubString(scoreStr, "RIGHT!", SCORE_START_POS);
-	display.writeStr(scoreStr, 1, 0);
-
-	char pointString[] = "   -   ";
-	if (lPoints < 10) {
-		pointString[1] = '0' + lPoints;
-	} else {
-		pointString[0] = '0' + lPoints/10;
-		pointString[1] = '0' + lPoints%10;
+		x = 126;
+		velX = -Balls::Physics::INIT_SPEED;
 	}
-	if (lPoints < 10) {
-		pointString[5] = '0' + rPoints;
-	} else {
-		pointString[5] = '0' + rPoints/10;
-		pointString[6] = '0' + rPoints%10;
+	for (uint8_t i=0; i<Balls::BALLS; i++) {
+		balls.setX(i, x);
+		balls.setVelX(i, velX);
 	}
 	
-	display.writeStr(pointString, 60 - 4*3, 28);
-	display.refresh();
-	
-	for (uint16_t i=0; i<255; i++) {
-		lPad.setY(readADC(PONG_L_PIN)); // [0-255]
-		rPad.setY(readADC(PONG_R_PIN)); // [0-255]
-		lPad.refresh(display);
-		rPad.refresh(display);
-		uint8_t height = p<0?lPad.getY():rPad.getY();
-		b.setY(height);
-		refreshBall();
+	// The main loop draws the pads and balls over the screen until the serve
+	server = p;
+	timer = PONG_TICKS(PONG_SERVE_MS);
+	state = PONG_SERVE;
+	changeScreen();
+}
+
+void Pong::serve() {
+	// Serve the balls in a fan around the pad's direction
+	// At a quarter of the pad's speed: the 9 bits between the formats, less 2
+	ball_vel_t velY = ball_vel_t::fromRaw((server<0?lPad.getVel():rPad.getVel()).rescale<11, int16_t>().getRaw());
+	for (uint8_t i=0; i<Balls::BALLS; i++) {
+		ball_vel_t fan = Balls::Physics::INIT_SPEED.div<4>() * ((i+1)/2);
+		balls.setVelY(i, velY + (i & 1 ? -fan : fan));
 	}
+#ifdef PONG_AI
+	ai.event();
+#endif
 	
-	b.setVelY((p<0?lPad.getVel():rPad.getVel())*128);
-	
+	// Clear the point screen, the main loop draws the pads and balls again
+	state = PONG_PLAY;
+	changeScreen();
+}
+
+void Pong::clearScreen() {
 	display.clear();
-	lPad.refresh(display);
-	rPad.refresh(display);
-	refreshBall();
-	display.refresh();
+	lPad.redraw();
+	rPad.redraw();
+	balls.redraw();
+}
+
+void Pong::showScreen() {
+	clearScreen();
+	if (state == PONG_SPLASH) {
+		display.show_P(screenSplash);
+	} else if (state == PONG_SERVE) {
+		display.show_P(screenPoint);
+		display.patchStr(server < 0 ? "LEFT!" : "RIGHT!", SCREEN_SCORER_X, SCREEN_SCORED_Y);
+#ifdef PONG_PROFILE
+		profOverlay(display, 8); // The timings so far, in place of the points
+#else
+		char pointString[] = "   -   ";
+		if (lPoints < 10) {
+			pointString[1] = '0' + lPoints;
+		} else {
+			pointString[0] = '0' + lPoints/10;
+			pointString[1] = '0' + lPoints%10;
+		}
+		if (lPoints < 10) {
+			pointString[5] = '0' + rPoints;
+		} else {
+			pointString[5] = '0' + rPoints/10;
+			pointString[6] = '0' + rPoints%10;
+		}
+		
+		display.patchStr(pointString, SCREEN_POINTS_X, SCREEN_POINTS_Y);
+#endif
+	}
+}
+
+void Pong::changeScreen() {
+	if (!quiet)
+		showScreen();
+}
+
+uint32_t Pong::screenKey() {
+	return (uint32_t)state | (uint32_t)(uint8_t)server << 8 | (uint32_t)(uint8_t)lPoints << 16 | (uint32_t)(uint8_t)rPoints << 24;
+}
+
+void Pong::setQuiet(uint8_t on) {
+	if (on) {
+		shown = screenKey();
+	} else if (quiet && screenKey() != shown) {
+		showScreen();
+	}
+	quiet = on;
+}
+
+void Pong::save(pong_state_t &s) {
+	balls.save(s.balls);
+	lPad.save(s.lPad);
+	rPad.save(s.rPad);
+	s.lPoints = lPoints;
+	s.rPoints = rPoints;
+	s.state = state;
+	s.timer = timer;
+	s.server = server;
+}
+
+void Pong::load(const pong_state_t &s) {
+	balls.load(s.balls);
+	lPad.load(s.lPad);
+	rPad.load(s.rPad);
+	lPoints = s.lPoints;
+	rPoints = s.rPoints;
+	state = s.state;
+	timer = s.timer;
+	server = s.server;
+}
+
+/** Adds the two bytes of a value to a Fletcher-16 sum, see telemetryFletcher */
+static void fletcher(uint8_t *sum, uint16_t v) {
+	telemetryFletcher(sum, v & 0xFF);
+	telemetryFletcher(sum, v >> 8);
+}
+
+uint16_t Pong::checksum(const pong_state_t &s) {
+	// Value by value, so padding and the layout of the struct do not count
+	uint8_t sum[2] = {0, 0};
+	for (uint8_t i=0; i<Balls::BALLS; i++) {
+		fletcher(sum, s.balls.posX[i].getRaw());
+		fletcher(sum, s.balls.posY[i].getRaw());
+		fletcher(sum, s.balls.prevX[i].getRaw());
+		fletcher(sum, s.balls.prevY[i].getRaw());
+		fletcher(sum, s.balls.velX[i].getRaw());
+		fletcher(sum, s.balls.velY[i].getRaw());
+		fletcher(sum, s.balls.spin[i].getRaw());
+	}
+	fletcher(sum, s.lPad.y.getRaw());
+	fletcher(sum, s.rPad.y.getRaw());
+	fletcher(sum, (uint8_t)s.lPad.vel.getRaw() | (uint8_t)s.rPad.vel.getRaw() << 8);
+	fletcher(sum, (uint8_t)s.lPoints | (uint8_t)s.rPoints << 8);
+	fletcher(sum, s.state | (uint8_t)s.server << 8);
+	fletcher(sum, s.timer);
+	return sum[1] << 8 | sum[0];
 }
 
 void Pong::drawBoundaries() {
-	display.line(0, 0, SSD1306_LCDWIDTH-1, 0, 0);
-	display.line(0, SSD1306_LCDHEIGHT-1, SSD1306_LCDWIDTH-1, SSD1306_LCDHEIGHT-1, 0);
+	display.hSpan<SSD1306_SET>(0, SSD1306_LCDWIDTH-1, 0);
+	display.hSpan<SSD1306_SET>(0, SSD1306_LCDWIDTH-1, SSD1306_LCDHEIGHT-1);
 }
 
 int8_t Pong::madePoint(int8_t l_rn) {
@@ -138,34 +306,4 @@ int8_t Pong::madePoint(int8_t l_rn) {
 	} else {
 		return 0;
 	}
-}
-
-uint8_t Ball::touchWalls(Pong &pong) {
-	// Teleport left <-> right
-	// TODO: Change this to point system
-	if (pos.x < 0) {
-		setX(1);
-		vel.x = -BALL_INIT_SPEED;
-		vel.y = 0;
-		spin = 0;
-		pong.madePoint(-1);
-	} else if (pos.x >= 128*PIX_SCL) {
-		setX(126);
-		vel.x = BALL_INIT_SPEED;
-		vel.y = 0;
-		spin = 0;
-		pong.madePoint(1);
-	}
-	
-	// Bounce on top/bottom
-	if (pos.y < 0) {
-		pos.y = -pos.y;
-		vel.y *= -1;
-		return true;
-	} else if (pos.y >= 64*PIX_SCL) {
-		pos.y -= pos.y%(64*PIX_SCL);
-		vel.y *= -1;
-		return true;
-	}
-	return false;
 }
\ No newline at end of file
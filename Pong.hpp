@@ -3,34 +3,137 @@
 
 #include <avr/io.h>
 
+#include "clock.hpp"
 #include "ball.hpp"
 #include "pad.hpp"
 #include "ssd1306.hpp"
+#include "screens.hpp"
+#include "ai.hpp"
 #include "main.hpp"
 
 #define PONG_R_PIN 5
 #define PONG_L_PIN 4
 
+// Period of the Timer 0 tick in microseconds at any F_CPU, the 22 counts of CLK/256 at 1 MHz the game was tuned with
+#define PONG_TICK_US (256UL*(65/PONG_SPEED_SCL + 1))
+typedef ClockTimer0<PONG_TICK_US> PongTick; // See initRefreshInterrupt
+#define PONG_TICKS(ms) ((uint16_t)((uint32_t)(ms)*1000/PONG_TICK_US))
+#define PONG_SPLASH_MS 3000 // Time the splash screen is shown at power on
+#define PONG_SERVE_MS 850 // Time the point screen is shown before the balls are served
+
+// States of the game, see Pong::update
+enum {
+	PONG_SPLASH, // Splash screen, counting down to the first serve
+	PONG_SERVE,  // Point screen, the scorer's pad holds the balls until they are served
+	PONG_PLAY    // Balls in play
+};
+
+/** What a rollback of the game restores: the motion of the balls and pads, the score and the
+ * state with its timer. Not what is drawn, the game draws the difference after a load.
+ */
+typedef struct {
+	Balls::state_t balls;
+	pad_state_t lPad, rPad;
+	int8_t lPoints, rPoints;
+	uint8_t state;
+	uint16_t timer;
+	int8_t server;
+} pong_state_t;
+
 class Pong {
 public:
 	Pong();
+	/** Shows the splash screen, which the game leaves by itself. Call once, before update. */
+	void start();
+	/** Advances the game by the ticks that passed: plays them, or counts them down on the splash
+	* and point screens. Never blocks, so the main loop keeps drawing, sampling and sending telemetry.
+	* @param steps Ticks that passed, from schedSteps
+	*/
+	void update(uint8_t steps);
+	/** Moves the pads to the inputs of one tick, then advances the game by the tick. With
+	* PONG_LINK this is how the game is played, on inputs which are the same on both boards.
+	* @param left Input of the left pad, 0 to ADC_MAX
+	* @param right Input of the right pad, 0 to ADC_MAX
+	*/
+	void stepTick(uint16_t left, uint16_t right);
+	/** Reads the pads' input, and draws the pads unless the splash screen is shown. With
+	* PONG_LINK the pads are only drawn, stepTick moves them.
+	*/
 	void refreshPads();
 	void stepBall();
+	/** Draws the balls unless the splash screen is shown */
 	void refreshBall();
-	void menu();
-	void pointMenu();
+	/** Sends the pad and ball changes drawn since the last call to the display
+	* @return Number of bytes sent to the display
+	*/
+	uint16_t flush();
+	/** Sends the ball, pads and score as a telemetry record
+	* @param tick Current tick of the scheduler
+	* @param duty Percent of the time the CPU was awake since the last record
+	*/
+	void sendTelemetry(uint16_t tick, uint8_t duty);
+	SSD1306& getDisplay();
+	/**
+	* @param right Zero for the points of the left pad, non zero for the right
+	* @return Points made by the pad
+	*/
+	uint8_t getPoints(uint8_t right);
 	void drawBoundaries();
 	/** 
 	* @param l_rn Negative if left scored, positive if right scored. Zero to just return if someone made a point since last time;
 	* @return Negative value if left pad scored, positive if right
 	*/
 	int8_t madePoint(int8_t l_rn);
+	
+	void save(pong_state_t &s);
+	void load(const pong_state_t &s);
+	/** Fletcher-16 checksum of a state, the same on every build of the game with the same balls
+	* @param s State from save
+	*/
+	static uint16_t checksum(const pong_state_t &s);
+	/** While quiet, the game does not draw the screens of the states it enters, for ticks which
+	* are played again after a rollback. Leaving quiet draws the screen of the game as it is now,
+	* if it is not the one on the display.
+	* @param on TRUE to enter, FALSE to leave
+	*/
+	void setQuiet(uint8_t on);
 private:
-	Ball b;
+	Balls balls;
 	Pad lPad, rPad;
 	SSD1306 display;
-	point8_t lastPos;
+#ifdef PONG_AI
+	PadAI ai; // Plays the right pad
+#endif
+	
+	/** Gets the input of a pad, from the ADC or from the AI playing it
+	* @param pin PONG_L_PIN or PONG_R_PIN
+	* @return Position in the range of readADC
+	*/
+	uint16_t padInput(uint8_t pin);
 	int8_t lPoints, rPoints; // Last bit is used to check if points were made since last check
+	
+	uint8_t state; // PONG_SPLASH, PONG_SERVE or PONG_PLAY
+	uint16_t timer; // Ticks left on the splash or point screen
+	int8_t server; // Negative if the left pad serves, positive if the right
+	
+	/** Counts down the ticks of a screen
+	* @return TRUE when the time is up
+	*/
+	uint8_t countDown(uint8_t steps);
+	/** Shows the point screen and puts the balls at the pad which serves */
+	void pointMenu();
+	/** Serves the balls and clears the point screen */
+	void serve();
+	/** Clears the display and makes the next refresh draw the pads and balls again */
+	void clearScreen();
+	/** Draws the screen of the state: the splash screen, the point screen or the empty field */
+	void showScreen();
+	/** Shows the screen of a state the game entered, unless quiet */
+	void changeScreen();
+	/** What decides the screen of the state, see setQuiet */
+	uint32_t screenKey();
+	uint8_t quiet;
+	uint32_t shown; // screenKey when quiet was entered
 };
 
 #endif
\ No newline at end of file
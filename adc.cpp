@@ -0,0 +1,105 @@
+#include "adc.hpp"
+#include "bitops.h"
+#include "profiler.hpp"
+
+#define ADC_RING_MASK (ADC_OVERSAMPLE-1)
+// Filter delay of the average, in conversions: half its length in samples of a pin, which come every other conversion
+#define ADC_FILTER_DELAY (ADC_OVERSAMPLE-1)
+
+static uint8_t pins[2];
+static volatile adc_sample_t samples[2];
+// Last conversions of each pin, only used by the ISR
+static uint8_t ring[2][ADC_OVERSAMPLE];
+static uint8_t head[2];
+static uint16_t sums[2];
+static adc_latency_t latency = {0, 0, 0xFFFF, 0};
+static volatile uint16_t conversions = 0;
+// Changed by the ISR after every update. Readers copy the samples without masking interrupts, and
+// copy again if it changed meanwhile, so a reader never delays the interrupts.
+static volatile uint8_t seq = 0;
+// In free running mode the next conversion has already started with the old ADMUX when the
+// interrupt runs, so a new channel only applies to the conversion after that one.
+static uint8_t finishing, running; // Index into pins of the conversion which just finished/is running
+
+/** ISR on ADC conversion complete
+**/
+ISR(ADC_vect) {
+	PROFILE(PROF_ADC);
+	uint16_t t = ++conversions;
+	uint8_t i = finishing;
+	uint8_t v = ADCH; // Left adjusted, the 8 high bits
+	uint8_t h = head[i];
+	sums[i] += v - ring[i][h];
+	ring[i][h] = v;
+	head[i] = (h + 1) & ADC_RING_MASK;
+	samples[i].value = sums[i];
+	samples[i].time = t;
+	
+	// Alternate channels for the conversion after the one that is running
+	finishing = running;
+	running ^= 1;
+	ADMUX = (ADMUX & 0xF0) | pins[running];
+	seq++;
+}
+
+void initADC(uint8_t pin0, uint8_t pin1) {
+	pins[0] = pin0;
+	pins[1] = pin1;
+	finishing = 0;
+	running = 0; // The first two conversions both use pin0, the ISR switches from the third on
+	
+	ADMUX = BV(REFS0) | BV(ADLAR) | pin0; // AVcc, left adjusted result, first pin
+	ADCSRB = 0; // Free running
+	ADCSRA = BV(ADEN) | BV(ADATE) | BV(ADIE) | CLOCK_ADPS; // Enable ADC, auto trigger, interrupt, CLK/CLOCK_ADC_PRESCALER
+	ADCSRA |= BV(ADSC); // Start first conversion
+}
+
+static uint8_t slot(uint8_t pin) {
+	return pin == pins[0] ? 0 : 1;
+}
+
+adc_sample_t adcSample(uint8_t pin) {
+	adc_sample_t s = {0, 0};
+	if (pin != pins[0] && pin != pins[1])
+		return s;
+	uint8_t i = slot(pin);
+	uint8_t before;
+	do {
+		before = seq;
+		s.value = samples[i].value;
+		s.time = samples[i].time;
+	} while (seq != before);
+	return s;
+}
+
+uint16_t readADC(uint8_t pin) {
+	adc_sample_t s = adcSample(pin);
+	if (s.time) {
+		uint16_t late = adcTime() - s.time + ADC_FILTER_DELAY;
+		latency.reads++;
+		latency.total += late;
+		if (late < latency.min)
+			latency.min = late;
+		if (late > latency.max)
+			latency.max = late;
+	}
+	return s.value;
+}
+
+uint16_t adcTime() {
+	uint8_t before;
+	uint16_t t;
+	do {
+		before = seq;
+		t = conversions;
+	} while (seq != before);
+	return t;
+}
+
+uint16_t randVal() {
+	return (adcSample(pins[0]).value ^ adcSample(pins[1]).value);
+}
+
+adc_latency_t adcLatency() {
+	return latency;
+}
@@ -0,0 +1,61 @@
+#ifndef __ADC_H__
+#define __ADC_H__
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "clock.hpp"
+
+/* The ADC runs with left adjusted results at a fast prescaler and only the 8 high bits of each
+ * conversion are read. The last ADC_OVERSAMPLE conversions of each pin are kept in a ring, and
+ * their sum is the pin's value: a moving average, which has the range of a 10-bit result again.
+ * A larger ADC_OVERSAMPLE gives less noise and a later value, see adcLatency.
+ */
+#define ADC_OVERSAMPLE 4 // Power of two, at most 4 keeps the sum within 10 bits
+#define ADC_MAX (255*ADC_OVERSAMPLE) // Largest value
+
+/** Latest value of a sampled pin */
+typedef struct {
+	uint16_t value; // Sum of the last ADC_OVERSAMPLE 8-bit conversions
+	uint16_t time;  // Value of adcTime() when the newest conversion finished
+} adc_sample_t;
+
+/** How late the values given by readADC were: the conversions that finished since the newest
+ * sample in a value, plus the delay of the average, which lags (ADC_OVERSAMPLE-1)/2 of the pin's
+ * samples behind the newest one. In conversions, see CLOCK_ADC_CONVERSION_US.
+ */
+typedef struct {
+	uint32_t reads;
+	uint32_t total;
+	uint16_t min, max; // max - min is the jitter
+} adc_latency_t;
+
+/** Starts the ADC in free running mode, alternating between two pins. Each conversion is
+ * added to its pin's average in ADC_vect, so reading a value never waits for the ADC.
+ @param pin0 First pin to sample
+ @param pin1 Second pin to sample
+*/
+void initADC(uint8_t pin0, uint8_t pin1);
+
+/** Gets the value of a pin for use, and counts how late it is in adcLatency
+ @param pin One of the pins given to initADC
+ @return Latest value, 0 to ADC_MAX, or 0 if the pin is not sampled
+*/
+uint16_t readADC(uint8_t pin);
+
+/** Gets the latest value of a pin together with the time it was taken
+ @param pin One of the pins given to initADC
+*/
+adc_sample_t adcSample(uint8_t pin);
+
+/** Number of finished conversions, the time base of the samples. One conversion is
+ * 13 ADC clocks, i.e. 13*CLOCK_ADC_PRESCALER CPU cycles.
+*/
+uint16_t adcTime();
+
+/** Gets the latency of the values read with readADC so far */
+adc_latency_t adcLatency();
+
+/** Random value from the noise in the lowest bits of the samples */
+uint16_t randVal();
+
+#endif /* __ADC_H__ */
@@ -0,0 +1,58 @@
+#include "ai.hpp"
+#include "adc.hpp"
+
+static const ai_level_t levels[AI_LEVELS] = {
+	{24, 6},
+	{12, 4},
+	{6, 2},
+	{0, 0},
+};
+
+/** (1 - 1/damp)^n in Q15, the part of the vertical velocity left after n ticks */
+uint16_t PadAI::_decay(uint16_t n, int16_t damp) {
+	uint32_t result = AI_ONE, base = AI_ONE - AI_ONE/damp;
+	while (n) {
+		if (n & 1)
+			result = result*base >> 15;
+		base = base*base >> 15;
+		n >>= 1;
+	}
+	return result;
+}
+
+PadAI::PadAI(uint8_t x, uint8_t level, uint16_t seed) :
+	_x(x), _level(level < AI_LEVELS ? level : AI_LEVELS-1), _pending(TRUE), _delay(0),
+	_y(SSD1306_LCDHEIGHT/2), _target(SSD1306_LCDHEIGHT/2), _rand(seed) {
+}
+
+void PadAI::event() {
+	_pending = TRUE;
+	_delay = levels[_level].delay;
+}
+
+int8_t PadAI::_error() {
+	uint8_t error = levels[_level].error;
+	if (!error)
+		return 0;
+	// xorshift, seeded from the ADC noise unless given a seed
+	if (!_rand)
+		_rand = randVal() | 1;
+	_rand ^= _rand << 7;
+	_rand ^= _rand >> 9;
+	_rand ^= _rand << 8;
+	return (int8_t)(_rand % (2*error + 1)) - error;
+}
+
+void PadAI::_aim(int16_t y) {
+	y += _error();
+	_target = y < 0 ? 0 : y >= SSD1306_LCDHEIGHT ? SSD1306_LCDHEIGHT-1 : y;
+}
+
+uint16_t PadAI::_move() {
+	if (_y < _target)
+		_y += (_target - _y) < AI_SPEED ? _target - _y : AI_SPEED;
+	else if (_y > _target)
+		_y -= (_y - _target) < AI_SPEED ? _y - _target : AI_SPEED;
+	// Pad::getY is the input divided by 16, so aim for the middle of that step
+	return ((uint16_t)_y << 4) + 8;
+}
@@ -0,0 +1,138 @@
+#ifndef __AI_H__
+#define __AI_H__
+
+#include <avr/io.h>
+#include "ball.hpp"
+
+// Build with -DPONG_AI for single player, the right pad is then played by PadAI at level PONG_AI_LEVEL
+#ifndef PONG_AI_LEVEL
+#define PONG_AI_LEVEL 2
+#endif
+#define AI_LEVELS 4
+
+// Fastest the AI moves its pad, in pixels per main loop pass
+#define AI_SPEED 2
+// Limit of the spin correction of a prediction, in pixels
+#define AI_SPIN_BOUND 16
+
+typedef struct {
+	uint8_t delay; // Main loop passes between a change of course of the ball and the reaction
+	uint8_t error; // Largest aiming error, in pixels
+} ai_level_t;
+
+/** Computer player for one pad. Predicts where the balls meet the pad's column in closed form,
+ * from their position, velocity and spin, folding the bounces on the top and bottom walls, and
+ * moves the pad there. A prediction is only made after an event which changes the course of a
+ * ball (a pad bounce or a serve), so a pass without events costs almost nothing.
+ * The functions which take the balls work with any BallPool, and its Physics.
+ */
+class PadAI {
+public:
+	/**
+	 @param x Column of the pad the AI plays
+	 @param level Difficulty, 0 (easiest) to AI_LEVELS-1
+	 @param seed Start of the aiming errors, or 0 to take it from the ADC noise
+	*/
+	PadAI(uint8_t x, uint8_t level, uint16_t seed = 0);
+	
+	/** Tells the AI that a ball changed course. It reacts after its reaction delay. */
+	void event();
+	
+	/** Moves the pad towards the predicted meeting point, once per main loop pass
+	 @return Pad position in the range of readADC, for Pad::setY
+	*/
+	template<class POOL> uint16_t update(POOL &balls);
+	
+	/** Predicts the height where a ball meets a column
+	 @param balls The balls
+	 @param i Index of the ball
+	 @param x Column to meet
+	 @param ticks Set to the number of ticks until it does
+	 @return Pixel height, or -1 if the ball moves away from the column
+	*/
+	template<class POOL> static int16_t predict(POOL &balls, uint8_t i, uint8_t x, uint16_t &ticks);
+
+private:
+	uint8_t _x, _level;
+	uint8_t _pending, _delay;
+	int8_t _y, _target; // Pixel height of the pad and where it goes
+	uint16_t _rand;
+	
+	template<class POOL> void _solve(POOL &balls);
+	int8_t _error();
+	void _aim(int16_t y);
+	uint16_t _move();
+	static uint16_t _decay(uint16_t n, int16_t damp);
+};
+
+// ----------------------------------- IMPLEMENTATION -----------------------------------
+
+// Fixed point of the damping factors, Q15
+#define AI_ONE 32768L
+
+template<class POOL>
+int16_t PadAI::predict(POOL &balls, uint8_t i, uint8_t x, uint16_t &ticks) {
+	typedef typename POOL::Physics Physics;
+	point16_t pos = balls.getPos(i), vel = balls.getVel(i);
+	int16_t dx = divide<POOL::VEL_SCL>(vel.x); // Sub-pixels per tick, constant between bounces
+	// First sub-pixel of the column the pads are hit in (column 0 reaches below 0, see getX)
+	int16_t column = x ? x*POOL::PIX_SCL : POOL::PIX_SCL-1;
+	if (dx == 0 || (dx > 0) != (column > pos.x))
+		return -1;
+	int32_t n = ((int32_t)column - pos.x) / dx;
+	ticks = n;
+	
+	// Sum of the velocity over n ticks, which loses 1/VEL_DAMP of itself each tick:
+	// vel.y * VEL_DAMP * (1 - decay^n), in sub-pixels. fall is Q12 to stay within 32 bits.
+	int32_t fall = (AI_ONE - _decay(n, Physics::VEL_DAMP)) >> 3;
+	int32_t y = pos.y + (((int32_t)vel.y * Physics::VEL_DAMP / POOL::VEL_SCL) * fall >> 12);
+	
+	// Spin pushes the velocity by spin/SPIN_GAIN each tick, through the same damping. The spin
+	// itself decays too, which is left out, so the correction is bounded.
+	int32_t push = (int32_t)balls.getSpin(i) / Physics::SPIN_GAIN;
+	if (vel.x < 0)
+		push = -push;
+	int32_t spin = push * Physics::VEL_DAMP / POOL::VEL_SCL * (n - ((Physics::VEL_DAMP * fall) >> 12));
+	const int32_t bound = (int32_t)AI_SPIN_BOUND * POOL::PIX_SCL;
+	y += spin > bound ? bound : spin < -bound ? -bound : spin;
+	
+	// Fold the wall bounces: the path repeats every two heights, mirrored in the second
+	const int32_t height = (int32_t)SSD1306_LCDHEIGHT * POOL::PIX_SCL;
+	y %= 2*height;
+	if (y < 0)
+		y += 2*height;
+	if (y >= height)
+		y = 2*height - 1 - y;
+	return y / POOL::PIX_SCL;
+}
+
+template<class POOL>
+void PadAI::_solve(POOL &balls) {
+	// Go for the ball which arrives first, or wait in the middle
+	int16_t best = -1;
+	uint16_t bestTicks = 0xFFFF;
+	for (uint8_t i=0; i<POOL::BALLS; i++) {
+		uint16_t ticks;
+		int16_t y = predict(balls, i, _x, ticks);
+		if (y >= 0 && ticks < bestTicks) {
+			best = y;
+			bestTicks = ticks;
+		}
+	}
+	if (best < 0)
+		best = SSD1306_LCDHEIGHT/2;
+	_aim(best);
+}
+
+template<class POOL>
+uint16_t PadAI::update(POOL &balls) {
+	if (_delay) {
+		_delay--;
+	} else if (_pending) {
+		_pending = FALSE;
+		_solve(balls);
+	}
+	return _move();
+}
+
+#endif /* __AI_H__ */
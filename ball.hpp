@@ -1,47 +1,401 @@
 ﻿#ifndef __BALL_H__
 #define __BALL_H__
 
-class Pong;
-
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include "pad.hpp"
-#define PIX_SCL 128
-#define SPEED_SCL 3
-#define BALL_INIT_SPEED 8192/SPEED_SCL
+#include "fastdiv.hpp"
+#include "fixed.hpp"
+
+// Balls in play. Build with e.g. -DPONG_BALLS=4 for multi-ball.
+#ifndef PONG_BALLS
+#define PONG_BALLS 1
+#endif
+#define PONG_SPEED_SCL 3
+
+// Position of a ball in pixels, with 7 bits below a pixel
+typedef Fixed<7> ball_pos_t;
+// Velocity (and spin) of a ball in pixels per tick, with 13 bits below a pixel
+typedef Fixed<13> ball_vel_t;
 
-class Ball{
+/** Constants of the ball's motion and of its response to the pads, all scaled for a tick
+ * rate SPEED times the base rate. BallPool divides through these functions, so another set
+ * of constants (like the tuning tool's, which are read at run time) can be swapped in.
+ * @tparam SPEED Tick rate multiplier
+ */
+template<int16_t SPEED>
+struct BallPhysics {
+	// Damping per tick: spin loses 1/SPIN_DAMP and vertical velocity 1/VEL_DAMP of itself
+	static constexpr int16_t SPIN_DAMP = 128*SPEED;
+	static constexpr int16_t VEL_DAMP = 64*SPEED;
+	// Spin/SPIN_GAIN is added to the vertical velocity each tick
+	static constexpr int16_t SPIN_GAIN = 16*SPEED;
+	// Horizontal speed at serve, one pixel per tick at the base rate
+	static constexpr ball_vel_t INIT_SPEED = ball_vel_t::fromRaw(ball_vel_t::ONE/SPEED);
+	
+	static ball_vel_t spinLoss(ball_vel_t spin) {
+		return spin.template div<SPIN_DAMP>();
+	}
+	static ball_vel_t velLoss(ball_vel_t vel) {
+		return vel.template div<VEL_DAMP>();
+	}
+	static ball_vel_t spinPush(ball_vel_t spin) {
+		return spin.template div<SPIN_GAIN>();
+	}
+	/** Spin given to a ball by a pad moving at padVel. The 9 bits between the formats and the
+	* 1/SPEED are applied in one step, as the shift alone does not fit for fast pads. A pad which
+	* jumped gives the most spin that fits.
+	*/
+	static ball_vel_t padSpin(pad_vel_t padVel) {
+		return ball_vel_t::fromRaw(padVel.template rescale<4, int16_t>().template satScale<512, SPEED>().getRaw());
+	}
+	/** Vertical velocity a pad gives to a ball, away from the pad's middle
+	@param edge Pixels between where the ball hits and the nearest end of the pad, 0 to 3
+	*/
+	static ball_vel_t bounceVel(uint8_t edge) {
+		// Hardcoded values from testing.
+		switch (edge) {
+			case 0:
+				return ball_vel_t::fromRaw(ball_vel_t::ONE/SPEED);
+			case 1:
+				return ball_vel_t::fromRaw(ball_vel_t::ONE/2/SPEED);
+			case 2:
+				return ball_vel_t::fromRaw(ball_vel_t::ONE/8/SPEED);
+			default:
+				return ball_vel_t::fromRaw(ball_vel_t::ONE/64/SPEED);
+		}
+	}
+};
+
+template<int16_t SPEED> constexpr ball_vel_t BallPhysics<SPEED>::INIT_SPEED;
+
+/** All balls in play, with each property of the balls in its own array so a pass over one
+ * property walks through memory in order.
+ * @tparam CAPACITY Number of balls
+ * @tparam SPEED Tick rate multiplier, see SPEED_SCL
+ * @tparam PHYSICS Constants of the motion, see BallPhysics
+ */
+template<uint8_t CAPACITY, int16_t SPEED, class PHYSICS = BallPhysics<SPEED> >
+class BallPool {
 public:
-	Ball();
+	// Sub-pixel steps per pixel of the position
+	static constexpr int16_t PIX_SCL = ball_pos_t::ONE;
+	// The tick rate is SPEED_SCL times higher, and all per tick changes SPEED_SCL times smaller
+	static constexpr int16_t SPEED_SCL = SPEED;
+	// Velocity steps per sub-pixel and tick
+	static constexpr int16_t VEL_SCL = ball_vel_t::ONE/ball_pos_t::ONE;
+	static constexpr uint8_t BALLS = CAPACITY;
+	typedef PHYSICS Physics;
+	
+	/** The motion of the balls without what was drawn, which is what a rollback restores */
+	typedef struct {
+		ball_pos_t posX[CAPACITY], posY[CAPACITY];
+		ball_pos_t prevX[CAPACITY], prevY[CAPACITY];
+		ball_vel_t velX[CAPACITY], velY[CAPACITY];
+		ball_vel_t spin[CAPACITY];
+	} state_t;
+	
+	BallPool();
 	
-	/** Gets the pixel position of the ball by removing decimal part of position
+	/** Gets the pixel position of a ball by removing decimal part of position
+	@param i Index of the ball
 	@return Pixel position of ball
 	**/
-	int16_t getX();
-	int16_t getY();
+	int16_t getX(uint8_t i);
+	int16_t getY(uint8_t i);
 	
-	void setX(uint8_t x);
-	void setY(uint8_t y);
+	void setX(uint8_t i, uint8_t x);
+	void setY(uint8_t i, uint8_t y);
 	
-	point16_t getVel();
-	void setVelX(int16_t velX);
-	void setVelY(int16_t velY);
-	void revX();
+	// Raw values: position in 1/PIX_SCL pixels, velocity and spin in 1/(PIX_SCL*VEL_SCL) pixels per tick
+	point16_t getPos(uint8_t i);
+	point16_t getVel(uint8_t i);
+	int16_t getSpin(uint8_t i);
+	void setVelX(uint8_t i, ball_vel_t velX);
+	void setVelY(uint8_t i, ball_vel_t velY);
+	void revX(uint8_t i);
 	
-	uint8_t bouncePad(Pad &pad);
+	/** Moves all balls one tick */
+	void stepAll();
 	
-	void step();
+	/** Bounces the balls which touch a pad, or passed through its column during the last step.
+	* A ball which passed through is checked against the pad where it entered the column, and
+	* keeps the rest of its step on the way back, so the bounce does not depend on the step size.
+	@return Number of balls which bounced
+	*/
+	uint8_t bounceAll(Pad &pad);
 	
-	// Declared by classes which call these functions (system dependent)
-	uint8_t touchWalls(Pong &pong);
+	/** Bounces the balls on the top and bottom walls, and moves the balls which passed the
+	* left or right wall back in to serve again
+	@return Negative if a ball passed the left wall, positive if one passed the right wall, else 0
+	*/
+	int8_t touchWallsAll();
+	
+	/** Erases the balls which moved where they were last drawn, then draws all balls where they
+	* are now. Does nothing if no ball moved. Sent with the next flush of the display.
+	*/
+	void refreshAll(SSD1306 &display);
+	
+	/** Makes the next refreshAll draw all balls without erasing, after the display was cleared */
+	void redraw();
+	
+	/** Copies the motion of the balls. The next refreshAll erases the balls where they were
+	* drawn and draws them where a loaded state put them.
+	*/
+	void save(state_t &s);
+	void load(const state_t &s);
 
 private:
 	// Current position
-	point16_t pos;
+	ball_pos_t posX[CAPACITY], posY[CAPACITY];
+	// Position before the last step
+	ball_pos_t prevX[CAPACITY], prevY[CAPACITY];
 	// Speed
-	point16_t vel;
-	// Spin of ball
-	int16_t spin;
+	ball_vel_t velX[CAPACITY], velY[CAPACITY];
+	// Spin of balls
+	ball_vel_t spin[CAPACITY];
+	// Where the balls were last drawn
+	point8_t last[CAPACITY];
+	uint8_t drawn; // FALSE if last is not on the display
 };
 
-#endif
\ No newline at end of file
+typedef BallPool<PONG_BALLS, PONG_SPEED_SCL> Balls;
+
+// ----------------------------------- IMPLEMENTATION -----------------------------------
+// In the header, so pools with other capacities and speeds can be instantiated where they are used
+
+#define BALL_POOL template<uint8_t CAPACITY, int16_t SPEED, class PHYSICS>
+#define BALL_POOL_T BallPool<CAPACITY, SPEED, PHYSICS>
+
+BALL_POOL
+BALL_POOL_T::BallPool() {
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		posX[i] = prevX[i] = ball_pos_t::fromInt(128/2);
+		posY[i] = prevY[i] = ball_pos_t::fromInt(64/2);
+		velX[i] = PHYSICS::INIT_SPEED;
+		velY[i] = ball_vel_t();
+		spin[i] = ball_vel_t();
+		last[i].x = last[i].y = 0;
+	}
+	drawn = FALSE;
+}
+
+BALL_POOL
+void BALL_POOL_T::setX(uint8_t i, uint8_t x) {
+	posX[i] = ball_pos_t::fromInt(x);
+}
+
+BALL_POOL
+void BALL_POOL_T::setY(uint8_t i, uint8_t y) {
+	posY[i] = ball_pos_t::fromInt(y);
+}
+
+BALL_POOL
+void BALL_POOL_T::setVelX(uint8_t i, ball_vel_t v) {
+	velX[i] = v;
+}
+
+BALL_POOL
+void BALL_POOL_T::setVelY(uint8_t i, ball_vel_t v) {
+	velY[i] = v;
+}
+
+BALL_POOL
+int16_t BALL_POOL_T::getX(uint8_t i) {
+	return posX[i].toInt();
+}
+
+BALL_POOL
+int16_t BALL_POOL_T::getY(uint8_t i) {
+	return posY[i].toInt();
+}
+
+BALL_POOL
+point16_t BALL_POOL_T::getPos(uint8_t i) {
+	point16_t p = {posX[i].getRaw(), posY[i].getRaw()};
+	return p;
+}
+
+BALL_POOL
+point16_t BALL_POOL_T::getVel(uint8_t i) {
+	point16_t v = {velX[i].getRaw(), velY[i].getRaw()};
+	return v;
+}
+
+BALL_POOL
+int16_t BALL_POOL_T::getSpin(uint8_t i) {
+	return spin[i].getRaw();
+}
+
+BALL_POOL
+void BALL_POOL_T::revX(uint8_t i) {
+	velX[i] = -velX[i];
+}
+
+BALL_POOL
+uint8_t BALL_POOL_T::bounceAll(Pad& pad) {
+	point16_t posPad = {pad.getX(), pad.getY()};
+	posPad.y -= 4;
+	ball_vel_t padSpin = PHYSICS::padSpin(pad.getVel());
+	uint8_t bounced = 0;
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		int16_t x = getX(i), y = getY(i);
+		uint8_t stepped = x != posPad.x; // The ball stepped over the pad's column instead of into it
+		ball_pos_t face; // Side of the column the ball entered through, if it stepped over it
+		if (stepped) {
+			int16_t prev = prevX[i].toInt();
+			if (prev > posPad.x && x < posPad.x)
+				face = ball_pos_t::fromInt(posPad.x + 1);
+			else if (prev < posPad.x && x > posPad.x)
+				face = ball_pos_t::fromInt(posPad.x);
+			else
+				continue;
+			// Height where the step entered the column
+			ball_pos_t entry = face > posX[i] ? face - ball_pos_t::fromRaw(1) : face;
+			y = (prevY[i] + ball_pos_t::fromRaw((int16_t)((int32_t)(posY[i] - prevY[i]).getRaw() * (entry - prevX[i]).getRaw() / (posX[i] - prevX[i]).getRaw()))).toInt();
+		}
+		// Change direction if touching pad
+		if (y-posPad.y >= 8 || y-posPad.y < 0)
+			continue;
+		
+		// A ball which stepped over the pad goes on with the rest of its step, mirrored at the pad
+		ball_pos_t mirrored = face + (face - posX[i]);
+		velX[i] = -velX[i];
+		if (velX[i] > ball_vel_t()) {
+			setX(i, posPad.x + 1);
+			if (stepped && mirrored > posX[i])
+				posX[i] = mirrored;
+			spin[i] = spin[i].satAdd(-padSpin); // Spin inwards
+		} else if (velX[i] < ball_vel_t()) {
+			setX(i, posPad.x - 1);
+			if (stepped && mirrored < posX[i])
+				posX[i] = mirrored;
+			spin[i] = spin[i].satAdd(padSpin); // Spin inwards
+		}
+		prevX[i] = posX[i];
+		prevY[i] = posY[i];
+		// Velocity to add to ball
+		ball_vel_t dvel;
+		if (y-posPad.y < 4) {
+			dvel = -PHYSICS::bounceVel(y-posPad.y);
+		} else {
+			dvel = PHYSICS::bounceVel(7-(y-posPad.y));
+		}
+		// Weighted average between collision position and pad velocity, which always fits
+		// although velY*3 alone may not. A fast pad can then push the velocity to the limit.
+		velY[i] = ball_vel_t::fromWide(((ball_vel_t::wide_t)velY[i].getRaw()*3 + dvel.getRaw()) / 4);
+		velY[i] = velY[i].satAdd(padSpin);
+		bounced++;
+	}
+	return bounced;
+}
+
+BALL_POOL
+void BALL_POOL_T::stepAll() {
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		ball_vel_t s = spin[i];
+		s = s - PHYSICS::spinLoss(s);
+		spin[i] = s;
+		
+		ball_vel_t dv = PHYSICS::spinPush(s);
+		ball_vel_t vy = velY[i].satAdd((velX[i] > ball_vel_t())?dv:-dv);
+		vy = vy - PHYSICS::velLoss(vy);
+		velY[i] = vy;
+		
+		prevX[i] = posX[i];
+		prevY[i] = posY[i];
+		posX[i] += velX[i].template rescale<ball_pos_t::FRAC_BITS>();
+		posY[i] += vy.template rescale<ball_pos_t::FRAC_BITS>();
+	}
+}
+
+BALL_POOL
+int8_t BALL_POOL_T::touchWallsAll() {
+	int8_t point = 0;
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		// Teleport left <-> right
+		if (posX[i] < ball_pos_t()) {
+			setX(i, 1);
+			velX[i] = -PHYSICS::INIT_SPEED;
+			velY[i] = ball_vel_t();
+			spin[i] = ball_vel_t();
+			if (!point)
+				point = -1;
+		} else if (posX[i] >= ball_pos_t::fromInt(128)) {
+			setX(i, 126);
+			velX[i] = PHYSICS::INIT_SPEED;
+			velY[i] = ball_vel_t();
+			spin[i] = ball_vel_t();
+			if (!point)
+				point = 1;
+		}
+		
+		// Bounce on top/bottom
+		if (posY[i] < ball_pos_t()) {
+			posY[i] = -posY[i];
+			velY[i] = -velY[i];
+		} else if (posY[i] >= ball_pos_t::fromInt(64)) {
+			posY[i] -= ball_pos_t::fromRaw(posY[i].getRaw()%(64*PIX_SCL));
+			velY[i] = -velY[i];
+		}
+	}
+	return point;
+}
+
+BALL_POOL
+void BALL_POOL_T::refreshAll(SSD1306 &display) {
+	// Erase all moved balls first, so one ball's erase does not remove another one drawn at the same spot
+	if (drawn) {
+		uint8_t moved = FALSE;
+		for (uint8_t i=0; i<CAPACITY; i++) {
+			if (last[i].x != (uint8_t)getX(i) || last[i].y != (uint8_t)getY(i)) {
+				display.clear_pixel(last[i].x, last[i].y);
+				moved = TRUE;
+			}
+		}
+		if (!moved)
+			return;
+	}
+	drawn = TRUE;
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		last[i].x = getX(i);
+		last[i].y = getY(i);
+		display.set_pixel(last[i].x, last[i].y);
+	}
+}
+
+BALL_POOL
+void BALL_POOL_T::redraw() {
+	drawn = FALSE;
+}
+
+BALL_POOL
+void BALL_POOL_T::save(state_t &s) {
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		s.posX[i] = posX[i];
+		s.posY[i] = posY[i];
+		s.prevX[i] = prevX[i];
+		s.prevY[i] = prevY[i];
+		s.velX[i] = velX[i];
+		s.velY[i] = velY[i];
+		s.spin[i] = spin[i];
+	}
+}
+
+BALL_POOL
+void BALL_POOL_T::load(const state_t &s) {
+	for (uint8_t i=0; i<CAPACITY; i++) {
+		posX[i] = s.posX[i];
+		posY[i] = s.posY[i];
+		prevX[i] = s.prevX[i];
+		prevY[i] = s.prevY[i];
+		velX[i] = s.velX[i];
+		velY[i] = s.velY[i];
+		spin[i] = s.spin[i];
+	}
+}
+
+#undef BALL_POOL
+#undef BALL_POOL_T
+
+#endif
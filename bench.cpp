@@ -0,0 +1,253 @@
+#include "bench.hpp"
+
+#ifdef PONG_BENCH
+
+#include "ball.hpp"
+#include "screens.hpp"
+
+static void putStr(void (*put)(char c), const char *str) {
+	while (*str)
+		put(*str++);
+}
+
+static void putNum(void (*put)(char c), uint32_t val, uint8_t width) {
+	char str[11];
+	uint8_t n = 0;
+	do {
+		str[n++] = '0' + val%10;
+		val /= 10;
+	} while (val);
+	while (width-- > n)
+		put(' ');
+	while (n)
+		put(str[--n]);
+}
+
+/** Cycles of one Timer 0 tick at a SPEED_SCL, see initRefreshInterrupt */
+static uint32_t tickCycles(int16_t speed) {
+	return 256UL * (65/speed + 1);
+}
+
+/** Mean time of one tick of ball work with N balls */
+template<uint8_t N, int16_t SPEED>
+static uint32_t benchPool(SSD1306 &display) {
+	BallPool<N, SPEED> balls;
+	Pad lPad(0), rPad(127);
+	for (uint8_t i=0; i<N; i++) {
+		// Spread out, so the balls draw different pixels and some hit the pads
+		balls.setY(i, 4 + i*(56/N));
+		balls.setVelY(i, ball_vel_t::fromRaw((i & 1 ? -64 : 64) * (i+1)));
+		if (i & 2)
+			balls.revX(i);
+	}
+	display.clear();
+	display.flush();
+	
+	uint32_t total = 0;
+	for (uint16_t t=0; t<BENCH_TICKS; t++) {
+		uint16_t sweep = (t*8) & 0x3FF;
+		lPad.setY(sweep);
+		rPad.setY(0x3FF - sweep);
+		
+		prof_time_t start = profNow();
+		balls.stepAll();
+		balls.bounceAll(lPad);
+		balls.bounceAll(rPad);
+		balls.touchWallsAll();
+		lPad.refresh(display);
+		rPad.refresh(display);
+		balls.refreshAll(display);
+		display.flush();
+		total += (prof_time_t)(profNow() - start);
+	}
+	return total / BENCH_TICKS;
+}
+
+/** Balls which fit in a budget, on the line through the times of 1 and 16 balls */
+static uint32_t fit(uint32_t budget, uint32_t t1, uint32_t t16) {
+	if (t1 > budget)
+		return 0;
+	if (t16 <= t1)
+		return 16;
+	return 1 + (budget - t1) * 15 / (t16 - t1);
+}
+
+/** The power on configuration as initialise() sent it before SSD1306::configure */
+static void configureByCalls(SSD1306 &display) {
+	display.power(FALSE);
+	display.set_multiplex_ratio(0x3F);
+	display.set_display_offset(0);
+	display.set_display_start_line(0);
+	display.set_segment_remap(TRUE);
+	display.set_com_output_scan_direction(TRUE);
+	display.set_precharge_period(0x1, 0xF);
+	display.set_com_pins_hardware_configuration(1, 0);
+	display.set_contrast(0x7F);
+	display.set_memory_addressing_mode(0);
+	display.set_display_test(FALSE);
+	display.set_inverse(FALSE);
+	display.set_display_clock_ratio_and_oscillator_frequency(0x0, 0xF);
+	display.set_charge_pump_enable(TRUE);
+	display.power(TRUE);
+	display.pam_set_start_address(0);
+	display.pam_set_page_start(0);
+}
+
+static void putResult(void (*put)(char c), const char *name, uint32_t separate, uint32_t batched, uint16_t bytes) {
+	putStr(put, name);
+	putNum(put, separate, 10);
+	putNum(put, batched, 10);
+	putNum(put, bytes * 16UL * PROF_PER_CYCLE, 10);
+	put('\n');
+}
+
+/** Bytes of flash a compressed screen takes, see SSD1306::show_P */
+static uint16_t screenSize(const uint8_t *screen) {
+	uint16_t size = 0, left = SSD1306_LCDWIDTH*SSD1306_PAGES;
+	while (left) {
+		uint8_t n = pgm_read_byte(screen + size);
+		uint8_t len = (n & ~SSD1306_RLE_RUN) + 1;
+		size += n & SSD1306_RLE_RUN ? 2 : len + 1;
+		left -= len;
+	}
+	return size;
+}
+
+/** Time from the start of Pong::menu until the splash is on the display, drawn in the buffer
+ * and refreshed like before, and streamed from flash */
+static void benchSplash(SSD1306 &display, void (*put)(char c)) {
+	display.wait();
+	prof_time_t start = profNow();
+	display.clear();
+	display.writeStr(SCREEN_TITLE, SCREEN_TITLE_X, SCREEN_TITLE_Y);
+	display.writeStr(SCREEN_AUTHOR, SCREEN_AUTHOR_X, SCREEN_AUTHOR_Y);
+	display.refresh();
+	display.wait();
+	prof_time_t mid = profNow();
+	display.clear();
+	display.show_P(screenSplash);
+	prof_time_t stop = profNow();
+	
+	putStr(put, "splash, " PROF_UNIT "\n");
+	putStr(put, "           rendered  streamed       bus     flash\n");
+	putStr(put, "splash    ");
+	putNum(put, (prof_time_t)(mid - start), 10);
+	putNum(put, (prof_time_t)(stop - mid), 10);
+	putNum(put, (SSD1306_WINDOW_COST + SSD1306_LCDWIDTH*SSD1306_PAGES) * 16UL * PROF_PER_CYCLE, 10);
+	putNum(put, screenSize(screenSplash), 10);
+	putStr(put, "\npoint     ");
+	putNum(put, screenSize(screenPoint), 40);
+	put('\n');
+}
+
+void benchDisplay(SSD1306 &display, void (*put)(char c)) {
+	const uint8_t window[SSD1306_WINDOW_COST] = {0x21, 0, 127, 0x22, 0, 7};
+	uint32_t separate = 0, batched = 0;
+	display.wait();
+	for (uint16_t t=0; t<BENCH_TICKS; t++) {
+		prof_time_t start = profNow();
+		for (uint8_t i=0; i<SSD1306_WINDOW_COST; i++) {
+			display.begin();
+			display.command(window[i]);
+			display.end();
+		}
+		prof_time_t mid = profNow();
+		display.begin();
+		display.commands(window, SSD1306_WINDOW_COST);
+		display.end();
+		prof_time_t stop = profNow();
+		separate += (prof_time_t)(mid - start);
+		batched += (prof_time_t)(stop - mid);
+	}
+	
+	putStr(put, "display commands, " PROF_UNIT "\n");
+	putStr(put, "           separate   batched       bus\n");
+	putResult(put, "window    ", separate / BENCH_TICKS, batched / BENCH_TICKS, SSD1306_WINDOW_COST);
+	
+	prof_time_t start = profNow();
+	configureByCalls(display);
+	prof_time_t mid = profNow();
+	display.configure();
+	prof_time_t stop = profNow();
+	putResult(put, "configure ", (prof_time_t)(mid - start), (prof_time_t)(stop - mid), SSD1306::CONFIG_BYTES);
+	
+	benchSplash(display, put);
+}
+
+void benchBalls(SSD1306 &display, void (*put)(char c)) {
+	uint32_t t[3][3] = {
+		{benchPool<1, 1>(display), benchPool<4, 1>(display), benchPool<16, 1>(display)},
+		{benchPool<1, 2>(display), benchPool<4, 2>(display), benchPool<16, 2>(display)},
+		{benchPool<1, 3>(display), benchPool<4, 3>(display), benchPool<16, 3>(display)},
+	};
+	const uint8_t balls[3] = {1, 4, 16};
+	
+	putStr(put, "ball work per tick, " PROF_UNIT "\n");
+	putStr(put, "balls      S=1      S=2      S=3\n");
+	for (uint8_t b=0; b<3; b++) {
+		putNum(put, balls[b], 5);
+		for (uint8_t s=0; s<3; s++)
+			putNum(put, t[s][b], 9);
+		put('\n');
+	}
+	putStr(put, "tick ");
+	for (uint8_t s=0; s<3; s++)
+		putNum(put, tickCycles(s+1) * PROF_PER_CYCLE, 9);
+	putStr(put, "\nfit  ");
+	for (uint8_t s=0; s<3; s++)
+		putNum(put, fit(tickCycles(s+1) * PROF_PER_CYCLE, t[s][0], t[s][2]), 9);
+	put('\n');
+}
+
+// Sprites of the sizes of a ball, an icon and a wide pad, see SSD1306::blit_P
+static const uint8_t spriteBall[] PROGMEM = {3, 3, 0x02, 0x07, 0x02};
+static const uint8_t spriteIcon[] PROGMEM = {8, 8, 0x3C, 0x42, 0xA5, 0x81, 0xA5, 0x99, 0x42, 0x3C};
+static const uint8_t spriteWide[] PROGMEM = {16, 12,
+	0xFF, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0xFF,
+	0x0F, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0F};
+
+/** Toggles the set pixels of a sprite one at a time, what drawing a sprite took without blit_P */
+static void togglePixels(SSD1306 &display, const uint8_t *sprite, uint8_t x, uint8_t y) {
+	uint8_t w = pgm_read_byte(sprite), h = pgm_read_byte(sprite + 1);
+	for (uint8_t r=0; r<h; r++) {
+		for (uint8_t c=0; c<w; c++) {
+			if (pgm_read_byte(sprite + 2 + r/8*w + c) & BV(r%8))
+				display.toggle_pixel(x + c, y + r);
+		}
+	}
+}
+
+static void benchSprite(SSD1306 &display, void (*put)(char c), const char *name, const uint8_t *sprite) {
+	uint8_t w = pgm_read_byte(sprite), h = pgm_read_byte(sprite + 1);
+	uint32_t blit = 0, pixels = 0;
+	for (uint16_t t=0; t<BENCH_TICKS; t++) {
+		uint8_t x = (t*7) % (SSD1306_LCDWIDTH - w + 1);
+		uint8_t y = (t*3) % (SSD1306_LCDHEIGHT - h + 1);
+		prof_time_t start = profNow();
+		display.blit_P(sprite, x, y, SSD1306_XOR);
+		display.blit_P(sprite, x, y, SSD1306_XOR);
+		prof_time_t mid = profNow();
+		togglePixels(display, sprite, x, y);
+		togglePixels(display, sprite, x, y);
+		prof_time_t stop = profNow();
+		blit += (prof_time_t)(mid - start);
+		pixels += (prof_time_t)(stop - mid);
+	}
+	putStr(put, name);
+	putNum(put, blit / BENCH_TICKS, 10);
+	putNum(put, pixels / BENCH_TICKS, 10);
+	put('\n');
+}
+
+void benchSprites(SSD1306 &display, void (*put)(char c)) {
+	display.clear();
+	display.flush();
+	display.wait();
+	putStr(put, "sprite draw and erase, " PROF_UNIT "\n");
+	putStr(put, "               blit    pixels\n");
+	benchSprite(display, put, "ball 3x3  ", spriteBall);
+	benchSprite(display, put, "icon 8x8  ", spriteIcon);
+	benchSprite(display, put, "wide 16x12", spriteWide);
+}
+
+#endif /* PONG_BENCH */
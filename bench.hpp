@@ -0,0 +1,47 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "profiler.hpp"
+#include "ssd1306.hpp"
+
+/* Build with -DPONG_BENCH (and PONG_PROFILE, for the clock) to run benchmarks instead of the game.
+ * Results are printed as text on the UART, or on stdout with pong_host_prof -b.
+ */
+#ifdef PONG_BENCH
+
+#ifndef PONG_PROFILE
+#error "PONG_BENCH needs PONG_PROFILE"
+#endif
+
+#define BENCH_TICKS 256 // Ticks timed per configuration
+
+/** Times the ball work of one tick with 1, 4 and 16 balls at SPEED_SCL 1, 2 and 3: step,
+ * bounce on both pads, walls, drawing pads and balls, and the flush. Then prints, for each
+ * SPEED_SCL, how many balls fit in its Timer 0 tick, interpolated between the measurements.
+ @param display Display to draw in, cleared before each configuration
+ @param put Called for every character of the results
+*/
+void benchBalls(SSD1306 &display, void (*put)(char c));
+
+/** Times sending commands to the display, each as a transaction of its own like before and
+ * batched in one transaction: the setup of one column/page window, and the power on
+ * configuration (SSD1306::configure against the same settings made one function at a time).
+ * Also prints the bus part of each, 16 cycles per byte at SPI CLK/2. Then times how long the
+ * splash screen takes to show, rendered in the buffer and streamed from flash, with the flash
+ * size of the static screens.
+ @param display Display to send to, left configured and showing the splash
+ @param put Called for every character of the results
+*/
+void benchDisplay(SSD1306 &display, void (*put)(char c));
+
+/** Times drawing sprites of several sizes with SSD1306::blit_P against toggling their pixels one
+ * at a time with toggle_pixel, at positions which mostly straddle two pages. Each time is a draw
+ * and the erase with SSD1306_XOR, without the flush.
+ @param display Display to draw in, cleared first and left empty
+ @param put Called for every character of the results
+*/
+void benchSprites(SSD1306 &display, void (*put)(char c));
+
+#endif /* PONG_BENCH */
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,78 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+/* The one clock setting of the game. Build with -DF_CPU=8000000UL or 16000000UL to run faster, the
+ * timer, SPI and ADC settings below follow at compile time and the game runs at the same speed.
+ */
+#ifndef F_CPU
+#define F_CPU 1000000UL
+#endif
+#include <avr/io.h>
+
+#define CLOCK_MHZ (F_CPU/1000000UL)
+
+static_assert(F_CPU % 1000000UL == 0, "F_CPU must be a whole number of MHz");
+
+// ----------------------------------- TIMER 0 -----------------------------------
+
+/** Timer 0 in CTC mode firing every PERIOD_US microseconds. Uses the smallest prescaler the
+ * period fits in, for the finest count, and fails the build if the period is not a whole
+ * number of counts or too long for the 8-bit timer.
+ */
+template<uint32_t PERIOD_US>
+struct ClockTimer0 {
+	static const uint32_t CYCLES = PERIOD_US*CLOCK_MHZ;
+	static const uint16_t PRESCALER =
+		CYCLES <= 256UL ? 1 :
+		CYCLES <= 8*256UL ? 8 :
+		CYCLES <= 64*256UL ? 64 :
+		CYCLES <= 256*256UL ? 256 : 1024;
+	// Clock select bits of TCCR0B
+	static const uint8_t CS =
+		PRESCALER == 1 ? (1<<CS00) :
+		PRESCALER == 8 ? (1<<CS01) :
+		PRESCALER == 64 ? (1<<CS01) | (1<<CS00) :
+		PRESCALER == 256 ? (1<<CS02) : (1<<CS02) | (1<<CS00);
+	// Counts per period, OCR0A is one less
+	static const uint16_t COUNTS = CYCLES/PRESCALER;
+
+	static_assert(CYCLES <= 1024*256UL, "Tick period too long for Timer 0 at this F_CPU");
+	static_assert(CYCLES % PRESCALER == 0, "Tick period is not a whole number of Timer 0 counts at this F_CPU");
+};
+
+// ----------------------------------- SPI -----------------------------------
+
+// Fastest serial clock of the SSD1306, 100 ns clock cycle
+#define CLOCK_SPI_MAX_HZ 10000000UL
+
+// Smallest SPI clock divider with a serial clock the display can follow
+#define CLOCK_SPI_DIV \
+	(F_CPU/2 <= CLOCK_SPI_MAX_HZ ? 2 : \
+	 F_CPU/4 <= CLOCK_SPI_MAX_HZ ? 4 : \
+	 F_CPU/8 <= CLOCK_SPI_MAX_HZ ? 8 : 16)
+
+// SPR1:0 bits of SPCR and SPI2X of SPSR for the divider
+#define CLOCK_SPCR (CLOCK_SPI_DIV == 2 || CLOCK_SPI_DIV == 4 ? 0 : (1<<SPR0))
+#define CLOCK_SPSR (CLOCK_SPI_DIV == 2 || CLOCK_SPI_DIV == 8 ? (1<<SPI2X) : 0)
+
+static_assert(F_CPU/CLOCK_SPI_DIV <= CLOCK_SPI_MAX_HZ, "No SPI divider for the display at this F_CPU");
+
+// ----------------------------------- ADC -----------------------------------
+
+/* A fixed prescaler, so a conversion (13 ADC clocks) always takes 13*32 CPU cycles and the ADC
+ * interrupt costs the same share of the CPU at every clock. Only the 8 high bits of a result are
+ * used (see adc.hpp), which stay accurate with ADC clocks well above the 200 kHz of 10-bit results.
+ */
+#define CLOCK_ADC_PRESCALER 32
+#define CLOCK_ADC_MAX_HZ 1000000UL
+// ADPS2:0 of ADCSRA for CLOCK_ADC_PRESCALER
+#define CLOCK_ADPS \
+	(CLOCK_ADC_PRESCALER == 128 ? 7 : CLOCK_ADC_PRESCALER == 64 ? 6 : \
+	 CLOCK_ADC_PRESCALER == 32 ? 5 : CLOCK_ADC_PRESCALER == 16 ? 4 : \
+	 CLOCK_ADC_PRESCALER == 8 ? 3 : CLOCK_ADC_PRESCALER == 4 ? 2 : 1)
+// Time of one conversion
+#define CLOCK_ADC_CONVERSION_US (13UL*CLOCK_ADC_PRESCALER/CLOCK_MHZ)
+
+static_assert(F_CPU/CLOCK_ADC_PRESCALER <= CLOCK_ADC_MAX_HZ, "ADC clock above 1 MHz at this F_CPU");
+
+#endif /* __CLOCK_H__ */
@@ -0,0 +1,50 @@
+#ifndef __FASTDIV_H__
+#define __FASTDIV_H__
+
+#include <stdint.h>
+
+/* Division of signed 16-bit values by a constant, without the division routine.
+ *
+ * AVR has no divide instruction, so x/D calls a library routine which loops over all
+ * 16 bits. With D known at compile time the quotient can be found with shifts and,
+ * for the odd part of D, one multiplication by a fixed-point reciprocal. The result is
+ * rounded towards zero, exactly like the '/' operator.
+ */
+
+namespace fastdiv {
+
+/** Number of trailing zero bits, i.e. the power of two in d */
+constexpr uint8_t twos(int32_t d) {
+	return (d & 1) ? 0 : 1 + twos(d >> 1);
+}
+
+/** Reciprocal of odd m as ceil(2^s/m) */
+constexpr uint32_t recip(uint16_t m, uint8_t s) {
+	return (((uint32_t)1 << s) + m - 1) / m;
+}
+
+/** Smallest shift s for which floor(a*recip(m, s)/2^s) == a/m for every a in [0, 2^15] */
+constexpr uint8_t shift(uint16_t m, uint8_t s = 15) {
+	return (recip(m, s)*m - ((uint32_t)1 << s)) * 32768 < ((uint32_t)1 << s) ? s : shift(m, s + 1);
+}
+
+/** Magnitude a divided by odd m */
+template<uint16_t M> inline uint16_t odd(uint16_t a) {
+	return M == 1 ? a : (uint16_t)(((uint32_t)a * recip(M, shift(M))) >> shift(M));
+}
+
+}
+
+/** Divides by a constant, rounding towards zero.
+ @param x Dividend
+ @return x/D
+*/
+template<int16_t D> inline int16_t divide(int16_t x) {
+	static_assert(D > 0, "Only positive divisors");
+	// Magnitude first, so both the shift and the reciprocal round towards zero
+	uint16_t a = x < 0 ? -(uint16_t)x : x;
+	uint16_t q = fastdiv::odd<(D >> fastdiv::twos(D))>(a >> fastdiv::twos(D));
+	return x < 0 ? -q : q;
+}
+
+#endif /* __FASTDIV_H__ */
@@ -0,0 +1,167 @@
+#ifndef __FIXED_H__
+#define __FIXED_H__
+
+#include <stdint.h>
+#include "fastdiv.hpp"
+
+/* Fixed point numbers with FRAC fractional bits, stored in REP. Conversions between formats are
+ * shifts known at compile time, and like the '/' they replace they round towards zero.
+ *
+ * The plain operators wrap like the integers underneath. Build with -DFIXED_CHECK (the host build
+ * does) to redo every operation in a wider type and stop at the first result which does not fit.
+ * Where a value may legitimately run out of range, use the sat* functions, which clamp instead.
+ */
+
+#ifdef FIXED_CHECK
+/** Reports a result which does not fit and stops, defined by the host build in hw_host.cpp
+ @param wide The result
+ @param bytes Size of the type it had to fit in
+*/
+void fixedOverflow(int64_t wide, uint8_t bytes);
+#endif
+
+namespace fixed {
+
+/** Integer type with twice the bits of T, for intermediate results */
+template<class T> struct Wider;
+template<> struct Wider<int8_t> { typedef int16_t type; };
+template<> struct Wider<int16_t> { typedef int32_t type; };
+template<> struct Wider<int32_t> { typedef int64_t type; };
+
+/** Largest and smallest value of a signed integer type */
+template<class T> constexpr T maxOf() {
+	return (T)(((typename Wider<T>::type)1 << (8*sizeof(T) - 1)) - 1);
+}
+template<class T> constexpr T minOf() {
+	return (T)(-maxOf<T>() - 1);
+}
+
+/** Stops the host build at a result which does not fit, see FIXED_CHECK */
+template<class T, class W> inline T checked(W wide) {
+#ifdef FIXED_CHECK
+	if (wide > maxOf<T>() || wide < minOf<T>())
+		fixedOverflow(wide, sizeof(T));
+#endif
+	return (T)wide;
+}
+
+/** Clamps a wider value to the range of T */
+template<class T, class W> inline T saturate(W wide) {
+	return wide > maxOf<T>() ? maxOf<T>() : wide < minOf<T>() ? minOf<T>() : (T)wide;
+}
+
+}
+
+/** Fixed point number
+ * @tparam FRAC Number of fractional bits
+ * @tparam REP Signed integer the value is stored in
+ */
+template<uint8_t FRAC, class REP = int16_t>
+class Fixed {
+public:
+	typedef REP rep_t;
+	typedef typename fixed::Wider<REP>::type wide_t;
+	static constexpr uint8_t FRAC_BITS = FRAC;
+	// Raw value of 1, in the wider type as it may not fit in REP
+	static constexpr wide_t ONE = (wide_t)1 << FRAC;
+
+	constexpr Fixed() : _raw(0) {}
+
+	static constexpr Fixed fromRaw(REP raw) {
+		return Fixed(raw);
+	}
+	static constexpr Fixed fromInt(int16_t i) {
+		return Fixed((REP)((wide_t)i << FRAC));
+	}
+	/** Value of a constant, rounded to the nearest step when compiled, e.g. Fixed<7>::literal(0.5) */
+	static constexpr Fixed literal(double v) {
+		return Fixed((REP)(v*ONE + (v < 0 ? -0.5 : 0.5)));
+	}
+	/** Raw value of a wider result, checked with FIXED_CHECK */
+	static Fixed fromWide(wide_t raw) {
+		return Fixed(fixed::checked<REP>(raw));
+	}
+	/** Raw value of a wider result, clamped to the range of REP */
+	static Fixed sat(wide_t raw) {
+		return Fixed(fixed::saturate<REP>(raw));
+	}
+
+	constexpr REP getRaw() const {
+		return _raw;
+	}
+	/** Integer part, rounded towards zero */
+	int16_t toInt() const {
+		return divide<(int16_t)ONE>(_raw);
+	}
+
+	/** The value with TO fractional bits, stored in R
+	* @tparam TO Fractional bits of the result, dropped bits round towards zero
+	*/
+	template<uint8_t TO, class R = REP> Fixed<TO, R> rescale() const {
+		return Fixed<TO, R>::fromRaw(TO >= FRAC ?
+			fixed::checked<R>((typename fixed::Wider<R>::type)_raw << (TO >= FRAC ? TO - FRAC : 0)) :
+			fixed::checked<R>(divide<(int16_t)((wide_t)1 << (TO < FRAC ? FRAC - TO : 0))>(_raw)));
+	}
+
+	/** Divides by a constant, rounding towards zero, see divide */
+	template<int16_t D> Fixed div() const {
+		return Fixed((REP)divide<D>(_raw));
+	}
+
+	/** Multiplies by the constant fraction N/D, rounding towards zero. Splits N/D into its
+	* whole and remaining part, so no division runs. Both parts are computed wide and checked
+	* with FIXED_CHECK, the remaining part's product has to fit 16 bits for divide.
+	*/
+	template<int16_t N, int16_t D> Fixed scale() const {
+		return fromWide((wide_t)(N/D)*_raw + rest<N, D>());
+	}
+
+	Fixed operator+(Fixed b) const {
+		return fromWide((wide_t)_raw + b._raw);
+	}
+	Fixed operator-(Fixed b) const {
+		return fromWide((wide_t)_raw - b._raw);
+	}
+	Fixed operator-() const {
+		return fromWide(-(wide_t)_raw);
+	}
+	Fixed operator*(int16_t k) const {
+		return fromWide((wide_t)_raw*k);
+	}
+	Fixed& operator+=(Fixed b) {
+		return *this = *this + b;
+	}
+	Fixed& operator-=(Fixed b) {
+		return *this = *this - b;
+	}
+
+	/** Sum clamped to the range of REP */
+	Fixed satAdd(Fixed b) const {
+		return sat((wide_t)_raw + b._raw);
+	}
+	/** Product clamped to the range of REP */
+	Fixed satMul(int16_t k) const {
+		return sat((wide_t)_raw*k);
+	}
+	/** Multiplies by the constant fraction N/D like scale, clamped to the range of REP */
+	template<int16_t N, int16_t D> Fixed satScale() const {
+		return sat((wide_t)(N/D)*_raw + rest<N, D>());
+	}
+
+	bool operator==(Fixed b) const { return _raw == b._raw; }
+	bool operator!=(Fixed b) const { return _raw != b._raw; }
+	bool operator<(Fixed b) const { return _raw < b._raw; }
+	bool operator>(Fixed b) const { return _raw > b._raw; }
+	bool operator<=(Fixed b) const { return _raw <= b._raw; }
+	bool operator>=(Fixed b) const { return _raw >= b._raw; }
+
+private:
+	constexpr explicit Fixed(REP raw) : _raw(raw) {}
+	/** The remaining part (N%D)/D of scale, its product checked to fit the 16 bits of divide */
+	template<int16_t N, int16_t D> wide_t rest() const {
+		return divide<D>(fixed::checked<int16_t>((wide_t)(N%D)*_raw));
+	}
+	REP _raw;
+};
+
+#endif /* __FIXED_H__ */
@@ -0,0 +1,19 @@
+/* Host stand-in for <avr/interrupt.h> */
+#ifndef __HOST_INTERRUPT_H__
+#define __HOST_INTERRUPT_H__
+
+#include "hw_host.hpp"
+
+#define ISR(vector, ...) extern "C" void vector(void)
+#define sei() do { SREG |= (1<<SREG_I); } while (0)
+#define cli() do { SREG &= ~(1<<SREG_I); } while (0)
+
+extern "C" {
+void TIMER0_COMPA_vect(void) __attribute__((weak));
+void SPI_STC_vect(void) __attribute__((weak));
+void ADC_vect(void) __attribute__((weak));
+void USART_UDRE_vect(void) __attribute__((weak));
+void USART_RX_vect(void) __attribute__((weak));
+}
+
+#endif
@@ -0,0 +1,2 @@
+/* Host stand-in for <avr/io.h> */
+#include "hw_host.hpp"
@@ -0,0 +1,14 @@
+/* Host stand-in for <avr/sleep.h> */
+#ifndef __HOST_SLEEP_H__
+#define __HOST_SLEEP_H__
+
+#include "hw_host.hpp"
+
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode) do { (void)(mode); } while (0)
+#define sleep_enable() do { } while (0)
+#define sleep_disable() do { } while (0)
+#define sleep_cpu() host_sleep()
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * ball_test.cpp
+ *
+ * Bounces balls which step several pixels per tick on a pad, and compares them with balls which
+ * step into the pad's column at the same height: they have to bounce the same way, so a lower tick
+ * rate with longer steps plays the same game. Also checks the pads at the edges of the screen.
+ *
+ * Usage: ball_test   (or "make check")
+ */
+
+#include <stdio.h>
+
+#include "hw_host.hpp"
+#include "ball.hpp"
+
+typedef BallPool<1, 1> TestBalls;
+
+#define PAD_X 60
+#define PAD_INPUT (32 << 4) // Input which puts the pad's middle at row 32, before it moves
+
+// One row below the top of the pad, which is at rows 30 to 37 after movedPad
+static const ball_pos_t HIT_Y = ball_pos_t::fromInt(31) + ball_pos_t::fromRaw(TestBalls::PIX_SCL/2);
+static const ball_vel_t SPIN = ball_vel_t::fromRaw(ball_vel_t::ONE/4);
+
+/** A pad at column x which moved 2 pixels down to its position */
+static Pad movedPad(uint8_t x) {
+	Pad pad(x);
+	pad.setY(PAD_INPUT);
+	pad.setY(PAD_INPUT + 2*pad_pos_t::ONE);
+	return pad;
+}
+
+/** Steps a ball from x, y at velX and bounces it on the pad
+ @param s The ball after the step and bounce
+ @return Number of balls which bounced
+*/
+static uint8_t stepAndBounce(ball_pos_t x, ball_pos_t y, ball_vel_t velX, Pad &pad, TestBalls::state_t &s) {
+	TestBalls balls;
+	s = TestBalls::state_t();
+	s.posX[0] = x;
+	s.posY[0] = y;
+	s.velX[0] = velX;
+	s.spin[0] = SPIN;
+	balls.load(s);
+	balls.stepAll();
+	uint8_t bounced = balls.bounceAll(pad);
+	balls.save(s);
+	return bounced;
+}
+
+static int expect(int ok, const char *name, const char *what) {
+	if (!ok)
+		printf("%s: %s\n", name, what);
+	return ok;
+}
+
+/** A ball which steps over the pad's column bounces like one which steps into it
+ @param pixels Pixels per tick, 2 or more, negative to the left
+*/
+static int sweptBounce(const char *name, int8_t pixels) {
+	const ball_pos_t half = ball_pos_t::fromRaw(TestBalls::PIX_SCL/2);
+	int8_t dir = pixels > 0 ? 1 : -1;
+	// The face of the column the ball comes from, at PAD_X or PAD_X+1
+	ball_pos_t face = ball_pos_t::fromInt(dir > 0 ? PAD_X : PAD_X + 1);
+	ball_vel_t velX = ball_vel_t::fromInt(pixels);
+
+	// Both start half a pixel before the face. One pixel per tick ends inside the column, more
+	// ends beyond it.
+	ball_pos_t start = dir > 0 ? face - half : face + half;
+	ball_pos_t end = start + ball_pos_t::fromInt(pixels);
+	TestBalls::state_t swept, inside;
+	Pad pad = movedPad(PAD_X);
+	uint8_t n = stepAndBounce(start, HIT_Y, velX, pad, swept);
+	Pad same = movedPad(PAD_X);
+	stepAndBounce(start, HIT_Y, ball_vel_t::fromInt(dir), same, inside);
+
+	int ok = expect(n == 1, name, "did not bounce");
+	ok &= expect(swept.velX[0] == -velX, name, "horizontal velocity not reversed");
+	// The rest of the step, mirrored at the column's face
+	ok &= expect(swept.posX[0] == face + (face - end), name, "not mirrored at the pad");
+	ok &= expect(swept.velY[0] == inside.velY[0], name, "vertical velocity differs from a ball hitting inside the column");
+	ok &= expect(swept.spin[0] == inside.spin[0], name, "spin differs from a ball hitting inside the column");
+	ok &= expect(inside.velY[0] != ball_vel_t(), name, "the pad gave no vertical velocity");
+	return ok;
+}
+
+/** A ball which steps over the column beside the pad goes on */
+static int sweptMiss(const char *name) {
+	Pad pad = movedPad(PAD_X);
+	TestBalls::state_t s;
+	ball_pos_t start = ball_pos_t::fromInt(PAD_X - 2);
+	uint8_t n = stepAndBounce(start, ball_pos_t::fromInt(10), ball_vel_t::fromInt(3), pad, s);
+	int ok = expect(n == 0, name, "bounced beside the pad");
+	ok &= expect(s.posX[0] == start + ball_pos_t::fromInt(3), name, "stopped beside the pad");
+	return ok;
+}
+
+/** A pad at column 0 is entered from its left face at 0, which is no different from any other */
+static int leftEdge(const char *name) {
+	Pad pad = movedPad(0);
+	TestBalls::state_t s;
+	ball_pos_t start = -ball_pos_t::fromRaw(3*TestBalls::PIX_SCL/2);
+	uint8_t n = stepAndBounce(start, HIT_Y, ball_vel_t::fromInt(3), pad, s);
+	int ok = expect(n == 1, name, "did not bounce");
+	ok &= expect(s.posX[0] == -(start + ball_pos_t::fromInt(3)), name, "not mirrored at the pad");
+	return ok;
+}
+
+int main() {
+	int failed = 0;
+	failed += !sweptBounce("2 pixels per tick", 2);
+	failed += !sweptBounce("3 pixels per tick", 3);
+	failed += !sweptBounce("3 pixels per tick to the left", -3);
+	failed += !sweptMiss("step beside the pad");
+	failed += !leftEdge("pad at column 0");
+
+	if (failed) {
+		printf("ball_test: %d cases failed\n", failed);
+		return 1;
+	}
+	printf("ball_test: all cases passed\n");
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include <string.h>
+#include "display_host.hpp"
+#include "hw_host.hpp"
+#include "ssd1306.hpp"
+
+#define WIDTH SSD1306_LCDWIDTH
+#define PAGES SSD1306_PAGES
+
+static uint8_t gddram[WIDTH*PAGES];
+static uint8_t colStart = 0, colEnd = WIDTH-1, pageStart = 0, pageEnd = PAGES-1;
+static uint8_t col = 0, page = 0;
+static uint8_t cmd, args[2], argc = 0, pending = 0;
+static host_display_stats_t stats;
+
+/** Number of argument bytes following a command byte */
+static uint8_t argCount(uint8_t c) {
+	switch (c) {
+		case 0x21: case 0x22:
+			return 2;
+		case 0x81: case 0xD3: case 0xA8: case 0xDA: case 0x20:
+		case 0xD5: case 0xD9: case 0xDB: case 0x8D:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static void received(uint8_t b) {
+	if (PORT_SPI.value & BV(DD_SS))
+		return; // Not selected
+	stats.bytes++;
+	if (PORT_SSD.value & BV(DD_DC)) {
+		stats.data++;
+		gddram[col + page*WIDTH] = b;
+		if (++col > colEnd) {
+			col = colStart;
+			if (++page > pageEnd)
+				page = pageStart;
+		}
+		return;
+	}
+	
+	stats.commands++;
+	if (pending) {
+		args[argc++] = b;
+		if (--pending)
+			return;
+		if (cmd == 0x21) {
+			colStart = col = args[0] & 0x7F;
+			colEnd = args[1] & 0x7F;
+		} else if (cmd == 0x22) {
+			pageStart = page = args[0] & 0x07;
+			pageEnd = args[1] & 0x07;
+		}
+		return;
+	}
+	cmd = b;
+	argc = 0;
+	pending = argCount(b);
+}
+
+static void portWritten(uint8_t old, uint8_t now) {
+	if ((old & BV(DD_SS)) && !(now & BV(DD_SS)))
+		stats.selects++;
+}
+
+void host_display_attach() {
+	host_set_spi_sink(received);
+	host_set_portb_watch(portWritten);
+}
+
+const uint8_t *host_display_gddram() {
+	return gddram;
+}
+
+host_display_stats_t host_display_stats() {
+	return stats;
+}
+
+void host_display_reset_stats() {
+	memset(&stats, 0, sizeof(stats));
+}
+
+void host_display_print(FILE *f) {
+	for (uint8_t y=0; y<PAGES*8; y++) {
+		for (uint8_t x=0; x<WIDTH; x++)
+			fputc(gddram[x + y/8*WIDTH] & (1<<(y%8)) ? '#' : '.', f);
+		fputc('\n', f);
+	}
+}
@@ -0,0 +1,35 @@
+/*
+ * display_host.hpp
+ *
+ * Model of the SSD1306 on the host side of the SPI bus. Decodes the command stream
+ * (horizontal addressing mode) into a copy of the display's GDDRAM.
+ */ 
+
+
+#ifndef __DISPLAY_HOST_H__
+#define __DISPLAY_HOST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+	uint32_t bytes;    // Every byte on the bus
+	uint32_t commands; // Command bytes, including their arguments
+	uint32_t data;     // GDDRAM bytes
+	uint32_t selects;  // Times chip select was asserted (transactions)
+} host_display_stats_t;
+
+/** Connects the model to the SPI stand-in */
+void host_display_attach();
+
+/** Contents of the display memory, 8 pages of 128 columns */
+const uint8_t *host_display_gddram();
+
+/** Bus statistics since the last reset */
+host_display_stats_t host_display_stats();
+void host_display_reset_stats();
+
+/** Prints the display memory as text, one character per pixel */
+void host_display_print(FILE *f);
+
+#endif /* __DISPLAY_HOST_H__ */
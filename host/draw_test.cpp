@@ -0,0 +1,161 @@
+/*
+ * draw_test.cpp
+ *
+ * Draws rectangles, spans, lines and sprites partly or wholly off the display with the game's
+ * display driver, and compares what reaches the display model with the pixels expected after
+ * clipping. Built with the frame buffer (draw_test) and with the display list (draw_test_dl).
+ *
+ * Usage: draw_test   (or "make check")
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "hw_host.hpp"
+#include "display_host.hpp"
+#include "ssd1306.hpp"
+
+// 3x10 sprite: band 0 then the 2 rows of band 1, top pixel in bit 0
+static const uint8_t sprite[] PROGMEM = {3, 10, 0xA5, 0xFF, 0x81, 0x03, 0x01, 0x02};
+
+static uint8_t expected[SSD1306_PAGES*SSD1306_LCDWIDTH];
+
+/** Sets the expected pixels of a rectangle, the parts off the display left out */
+static void expectRect(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint8_t mode) {
+	for (int16_t y = y0; y < y1; y++) {
+		for (int16_t x = x0; x < x1; x++) {
+			if (x < 0 || x >= SSD1306_LCDWIDTH || y < 0 || y >= SSD1306_LCDHEIGHT)
+				continue;
+			uint8_t &b = expected[y/8*SSD1306_LCDWIDTH + x];
+			uint8_t bit = 1 << (y%8);
+			b = mode == SSD1306_SET ? b | bit : mode == SSD1306_CLEAR ? b & ~bit : b ^ bit;
+		}
+	}
+}
+
+/** Sets the expected pixels of the sprite drawn at x, y */
+static void expectSprite(int16_t x, int16_t y, uint8_t mode) {
+	uint8_t w = sprite[0], h = sprite[1];
+	for (uint8_t r = 0; r < h; r++) {
+		for (uint8_t c = 0; c < w; c++) {
+			if (sprite[2 + r/8*w + c] & (1 << (r%8)))
+				expectRect(x + c, y + r, x + c + 1, y + r + 1, mode);
+		}
+	}
+}
+
+/** Sends the drawing to the display model and compares it with the expected pixels
+ @return 1 if they match
+*/
+static int check(SSD1306 &display, const char *name) {
+	display.refresh();
+	display.wait();
+	const uint8_t *gddram = host_display_gddram();
+	for (uint16_t i = 0; i < sizeof(expected); i++) {
+		if (gddram[i] != expected[i]) {
+			printf("%s: column %u page %u is %02x, expected %02x\n", name,
+				i%SSD1306_LCDWIDTH, i/SSD1306_LCDWIDTH, gddram[i], expected[i]);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/** Starts a case on a blank display */
+static void start(SSD1306 &display) {
+	display.clear();
+	memset(expected, 0, sizeof(expected));
+}
+
+int main() {
+	host_display_attach();
+	SSD1306 display;
+	int failed = 0;
+
+	start(display);
+	display.fillRect<SSD1306_SET>(120, 60, 200, 200);
+	expectRect(120, 60, 200, 200, SSD1306_SET);
+	failed += !check(display, "rectangle over the corner");
+
+	start(display);
+	display.fillRect<SSD1306_SET>(130, 10, 140, 20);
+	display.fillRect<SSD1306_SET>(10, 70, 20, 80);
+	display.fillRect<SSD1306_SET>(200, 200, 255, 255);
+	failed += !check(display, "rectangles off the display");
+
+	start(display);
+	display.fillRect<SSD1306_SET>(0, 8, 128, 16);
+	display.fillRect<SSD1306_XOR>(100, 12, 255, 14);
+	expectRect(0, 8, 128, 16, SSD1306_SET);
+	expectRect(100, 12, 255, 14, SSD1306_XOR);
+	failed += !check(display, "toggled rectangle over the right edge");
+
+	start(display);
+	display.fillRect<SSD1306_SET>(0, 0, 128, 8);
+	display.fillRect<SSD1306_CLEAR>(60, 2, 250, 5);
+	expectRect(0, 0, 128, 8, SSD1306_SET);
+	expectRect(60, 2, 250, 5, SSD1306_CLEAR);
+	failed += !check(display, "cleared rectangle over the right edge");
+
+	start(display);
+	display.hSpan<SSD1306_SET>(100, 250, 5);
+	display.hSpan<SSD1306_SET>(0, 10, 64);
+	display.hSpan<SSD1306_SET>(0, 10, 255);
+	display.vSpan<SSD1306_SET>(127, 50, 255);
+	display.vSpan<SSD1306_SET>(128, 0, 10);
+	display.vSpan<SSD1306_SET>(255, 0, 10);
+	expectRect(100, 5, 250, 6, SSD1306_SET);
+	expectRect(127, 50, 128, 255, SSD1306_SET);
+	failed += !check(display, "spans");
+
+	start(display);
+	display.line(5, 10, 5, 40, SSD1306_SET);
+	display.line(0, 63, 127, 63, SSD1306_SET);
+	display.line(120, 30, 120, 200, SSD1306_SET);
+	expectRect(5, 10, 6, 40, SSD1306_SET);
+	expectRect(0, 63, 127, 64, SSD1306_SET);
+	expectRect(120, 30, 121, 200, SSD1306_SET);
+	failed += !check(display, "lines along the axes");
+
+	start(display);
+	display.blit_P(sprite, -1, -3, SSD1306_SET);
+	display.blit_P(sprite, 126, 60, SSD1306_SET);
+	display.blit_P(sprite, 140, 20, SSD1306_SET);
+	expectSprite(-1, -3, SSD1306_SET);
+	expectSprite(126, 60, SSD1306_SET);
+	failed += !check(display, "sprites over the edges");
+
+	start(display);
+	display.blit_P(sprite, 100, 37, SSD1306_SET);
+	expectSprite(100, 37, SSD1306_SET);
+	failed += !check(display, "sprite across two pages");
+
+	start(display);
+	display.fillRect<SSD1306_SET>(0, 16, 8, 24);
+	display.blit_P(sprite, 2, 19, SSD1306_CLEAR);
+	expectRect(0, 16, 8, 24, SSD1306_SET);
+	expectSprite(2, 19, SSD1306_CLEAR);
+	failed += !check(display, "cleared sprite across two pages");
+
+	start(display);
+	display.fillRect<SSD1306_SET>(40, 20, 48, 26);
+	display.blit_P(sprite, 42, 22, SSD1306_XOR);
+	expectRect(40, 20, 48, 26, SSD1306_SET);
+	expectSprite(42, 22, SSD1306_XOR);
+	failed += !check(display, "toggled sprite across two pages");
+
+	start(display);
+	display.fillRect<SSD1306_SET>(40, 20, 48, 26);
+	display.blit_P(sprite, 42, 22, SSD1306_XOR);
+	display.blit_P(sprite, 42, 22, SSD1306_XOR);
+	expectRect(40, 20, 48, 26, SSD1306_SET);
+	failed += !check(display, "sprite toggled twice");
+
+	if (failed) {
+		printf("draw_test: %d cases failed\n", failed);
+		return 1;
+	}
+	printf("draw_test: all cases passed\n");
+	return 0;
+}
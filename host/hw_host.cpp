@@ -0,0 +1,228 @@
+/*
+ * hw_host.cpp
+ *
+ * Peripheral models behind the host register stand-ins.
+ */ 
+
+#include "hw_host.hpp"
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fixed.hpp"
+
+static void sregWritten(HostReg8 &reg, uint8_t old);
+static void spdrWritten(HostReg8 &reg, uint8_t old);
+static void adcsraWritten(HostReg8 &reg, uint8_t old);
+static void udrWritten(HostReg8 &reg, uint8_t old);
+static void dispatchWritten(HostReg8 &reg, uint8_t old);
+static void portbWritten(HostReg8 &reg, uint8_t old);
+
+HostReg8 SREG(sregWritten);
+HostReg8 PORTB(portbWritten), DDRB, PINB, PORTC, DDRC, PINC, PORTD, DDRD, PIND;
+HostReg8 SPCR, SPSR, SPDR(spdrWritten);
+HostReg8 ADMUX, ADCSRA(adcsraWritten), ADCSRB, DIDR0;
+volatile uint16_t ADC;
+HostReg8 TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+HostReg8 TCCR1A, TCCR1B;
+HostReg8 UCSR0A(0, 1<<UDRE0), UCSR0B(dispatchWritten), UCSR0C, UBRR0H, UBRR0L, UDR0(udrWritten);
+volatile uint16_t TCNT1;
+
+uint64_t host_time_us = 0;
+
+static host_adc_source_t adcSource = 0;
+static host_spi_sink_t spiSink = 0;
+static host_uart_sink_t uartSink = 0;
+static host_uart_source_t uartSource = 0;
+static host_port_watch_t portbWatch = 0;
+static uint8_t inISR = 0;
+
+void host_set_adc_source(host_adc_source_t source) {
+	adcSource = source;
+}
+
+void host_set_spi_sink(host_spi_sink_t sink) {
+	spiSink = sink;
+}
+
+void host_set_uart_sink(host_uart_sink_t sink) {
+	uartSink = sink;
+}
+
+void host_set_uart_source(host_uart_source_t source) {
+	uartSource = source;
+}
+
+void host_set_portb_watch(host_port_watch_t watch) {
+	portbWatch = watch;
+}
+
+static void portbWritten(HostReg8 &reg, uint8_t old) {
+	if (portbWatch)
+		portbWatch(old, reg.value);
+}
+
+static void runISR(void (*vect)(void)) {
+	// The hardware clears the I-flag when entering an ISR and sets it again on return
+	inISR = 1;
+	SREG.value &= ~(1<<SREG_I);
+	if (vect)
+		vect();
+	SREG.value |= (1<<SREG_I);
+	inISR = 0;
+}
+
+void host_dispatch() {
+	// ISRs do not nest, pending interrupts run when the current one returns
+	while (!inISR && (SREG.value & (1<<SREG_I))) {
+		if ((SPCR.value & (1<<SPIE)) && (SPSR.value & (1<<SPIF))) {
+			SPSR.value &= ~(1<<SPIF);
+			runISR(SPI_STC_vect);
+		} else if ((ADCSRA.value & (1<<ADIE)) && (ADCSRA.value & (1<<ADIF))) {
+			ADCSRA.value &= ~(1<<ADIF);
+			runISR(ADC_vect);
+		} else if ((UCSR0B.value & (1<<RXCIE0)) && (UCSR0A.value & (1<<RXC0))) {
+			UCSR0A.value &= ~(1<<RXC0); // Cleared by the ISR reading UDR0 on the part
+			runISR(USART_RX_vect);
+		} else if ((UCSR0B.value & (1<<UDRIE0)) && (UCSR0A.value & (1<<UDRE0))) {
+			runISR(USART_UDRE_vect); // Level triggered, the ISR writes UDR0 or turns the interrupt off
+		} else if ((TIMSK0.value & (1<<OCIE0A)) && (TIFR0.value & (1<<OCF0A))) {
+			TIFR0.value &= ~(1<<OCF0A);
+			runISR(TIMER0_COMPA_vect);
+		} else {
+			break;
+		}
+	}
+}
+
+static void sregWritten(HostReg8 &, uint8_t) {
+	host_dispatch();
+}
+
+static void spdrWritten(HostReg8 &reg, uint8_t) {
+	if (spiSink)
+		spiSink(reg.value);
+	SPSR.value |= (1<<SPIF);
+	host_dispatch();
+}
+
+// Channel of the conversion in progress, latched from ADMUX when it started
+static uint8_t adcChannel = 0;
+
+static void convert() {
+	uint16_t result = adcSource ? adcSource(adcChannel) & 0x3FF : 0;
+	ADC = (ADMUX.value & (1<<ADLAR)) ? result << 6 : result;
+	ADCSRA.value |= (1<<ADIF);
+	if (ADCSRA.value & (1<<ADATE)) {
+		// Free running: the next conversion starts right away, before the ISR can change ADMUX
+		adcChannel = ADMUX.value & 0x0F;
+	} else {
+		ADCSRA.value &= ~(1<<ADSC);
+	}
+}
+
+static void adcsraWritten(HostReg8 &reg, uint8_t) {
+	// Writing a one to ADIF clears it
+	if (reg.value & (1<<ADIF))
+		reg.value &= ~(1<<ADIF);
+	if ((reg.value & (1<<ADEN)) && (reg.value & (1<<ADSC))) {
+		adcChannel = ADMUX.value & 0x0F;
+		if (!(reg.value & (1<<ADATE)))
+			convert(); // Single conversions finish right away, free running ones as time passes
+	}
+	host_dispatch();
+}
+
+// CPU cycles since the last free running conversion finished
+static uint32_t adcCycles = 0;
+
+/** Finishes the free running conversions which fit in the time that passed */
+static void adcRun(uint32_t cycles) {
+	if (!((ADCSRA.value & (1<<ADEN)) && (ADCSRA.value & (1<<ADATE)) && (ADCSRA.value & (1<<ADSC)))) {
+		adcCycles = 0;
+		return;
+	}
+	uint8_t adps = ADCSRA.value & 7;
+	uint32_t conversion = 13UL << (adps ? adps : 1); // 13 ADC clocks at CLK/2^ADPS, CLK/2 for 0
+	adcCycles += cycles;
+	while (adcCycles >= conversion) {
+		adcCycles -= conversion;
+		convert();
+		host_dispatch();
+	}
+}
+
+// Prescaler selected by the CS02:0 bits of TCCR0B, 0 if the timer is stopped or clocked externally
+static uint16_t timer0Prescaler() {
+	static const uint16_t prescalers[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+	return prescalers[TCCR0B.value & 7];
+}
+
+void host_delay_us(uint32_t us) {
+	host_time_us += us;
+	adcRun(us * (HOST_F_CPU/1000000UL));
+}
+
+static void dispatchWritten(HostReg8 &, uint8_t) {
+	host_dispatch();
+}
+
+static void udrWritten(HostReg8 &reg, uint8_t) {
+	if (!(UCSR0B.value & (1<<TXEN0)))
+		return;
+	if (uartSink)
+		uartSink(reg.value);
+	UCSR0A.value &= ~(1<<UDRE0); // Free again when the byte has had its time on the line
+}
+
+// Bytes the UART may still send and receive in the current tick
+static double uartCredit = 0, rxCredit = 0;
+
+static void uartRun() {
+	if (!(UCSR0B.value & ((1<<TXEN0) | (1<<RXEN0))) || !timer0Prescaler())
+		return;
+	uint16_t ubrr = (UBRR0H.value << 8) | UBRR0L.value;
+	double baud = HOST_F_CPU / ((UCSR0A.value & (1<<U2X0)) ? 8.0 : 16.0) / (ubrr + 1);
+	double ticksPerSecond = HOST_F_CPU / (double)timer0Prescaler() / (OCR0A.value + 1);
+	double bytes = baud / 10 / ticksPerSecond; // 8N1 is 10 bits per byte
+	
+	if (UCSR0B.value & (1<<TXEN0)) {
+		uartCredit += bytes;
+		while (uartCredit >= 1 && !(UCSR0A.value & (1<<UDRE0))) {
+			uartCredit -= 1;
+			UCSR0A.value |= (1<<UDRE0);
+			host_dispatch();
+		}
+		if (UCSR0A.value & (1<<UDRE0) && uartCredit > 1)
+			uartCredit = 1; // An idle line does not save up time
+	}
+	
+	if ((UCSR0B.value & (1<<RXEN0)) && uartSource) {
+		rxCredit += bytes;
+		int16_t b;
+		while (rxCredit >= 1 && (b = uartSource()) >= 0) {
+			rxCredit -= 1;
+			UDR0.value = b; // A byte not read before the next one is lost, like an overrun on the part
+			UCSR0A.value |= (1<<RXC0);
+			host_dispatch();
+		}
+		if (rxCredit > 1)
+			rxCredit = 1;
+	}
+}
+
+void host_timer0_tick() {
+	adcRun((uint32_t)timer0Prescaler() * (OCR0A.value + 1));
+	uartRun();
+	TCNT0.value = 0; // CTC restarts the count at the compare match
+	TIFR0.value |= (1<<OCF0A);
+	host_dispatch();
+}
+
+void host_sleep() {
+	TCNT0.value = OCR0A.value;
+}
+
+void fixedOverflow(int64_t wide, uint8_t bytes) {
+	fprintf(stderr, "fixed point overflow: %lld does not fit in %u bytes\n", (long long)wide, bytes);
+	abort();
+}
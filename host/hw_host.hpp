@@ -0,0 +1,196 @@
+/*
+ * hw_host.hpp
+ *
+ * Stand-in for the ATmega328P registers and peripherals used by the game, so the
+ * game core can be built and run on the host (see Makefile, target pong_host).
+ *
+ * Registers are objects which behave like the volatile uint8_t of the real part.
+ * Writes to registers which start something (SPDR, ADCSRA, SREG) run the peripheral
+ * model, which completes the operation instantly and calls the ISR the same way the
+ * hardware would if the interrupt is enabled. The free running ADC and the UART are
+ * the exceptions, they run in simulated time: conversions finish as Timer 0 ticks and
+ * delays pass, and bytes go out at the baud rate, counted in Timer 0 ticks.
+ */ 
+
+
+#ifndef __HW_HOST_H__
+#define __HW_HOST_H__
+
+#include <stdint.h>
+
+class HostReg8 {
+public:
+	typedef void (*Hook)(HostReg8 &reg, uint8_t old);
+	// constexpr, so the registers are ready before the game objects are constructed
+	constexpr HostReg8(Hook onWrite = 0, uint8_t reset = 0) : value(reset), _onWrite(onWrite) {}
+	
+	operator uint8_t() const { return value; }
+	HostReg8& operator=(int v) {
+		uint8_t old = value;
+		value = (uint8_t)v;
+		if (_onWrite)
+			_onWrite(*this, old);
+		return *this;
+	}
+	HostReg8& operator=(const HostReg8 &r) { return *this = r.value; }
+	HostReg8& operator|=(int v) { return *this = value | v; }
+	HostReg8& operator&=(int v) { return *this = value & v; }
+	HostReg8& operator^=(int v) { return *this = value ^ v; }
+	
+	// Raw value, for the peripheral models to change without triggering the write hook
+	volatile uint8_t value;
+private:
+	Hook _onWrite;
+};
+
+extern HostReg8 SREG;
+extern HostReg8 PORTB, DDRB, PINB, PORTC, DDRC, PINC, PORTD, DDRD, PIND;
+extern HostReg8 SPCR, SPSR, SPDR;
+extern HostReg8 ADMUX, ADCSRA, ADCSRB, DIDR0;
+extern volatile uint16_t ADC;
+#define ADCH (*((volatile uint8_t*)&ADC + 1)) // High byte, the host is little endian too
+extern HostReg8 TCCR0A, TCCR0B, TCNT0, OCR0A, OCR0B, TIMSK0, TIFR0;
+extern HostReg8 TCCR1A, TCCR1B;
+extern HostReg8 UCSR0A, UCSR0B, UCSR0C, UBRR0H, UBRR0L, UDR0;
+extern volatile uint16_t TCNT1; // Not modelled, the host build of the profiler uses the host's clock
+
+// ----------------------------------- PERIPHERAL MODELS -----------------------------------
+
+/** Source of ADC samples, called when a conversion finishes
+ @param channel Selected ADMUX channel
+ @return 10-bit result
+*/
+typedef uint16_t (*host_adc_source_t)(uint8_t channel);
+void host_set_adc_source(host_adc_source_t source);
+
+/** Receiver of SPI bytes, called for every byte written to SPDR. Chip select and
+ * other pins are for the receiver to check in the port registers.
+ @param b The byte
+*/
+typedef void (*host_spi_sink_t)(uint8_t b);
+void host_set_spi_sink(host_spi_sink_t sink);
+
+/** Receiver of bytes sent by the UART, called when a byte is written to UDR0
+ @param b The byte
+*/
+typedef void (*host_uart_sink_t)(uint8_t b);
+void host_set_uart_sink(host_uart_sink_t sink);
+
+/** Source of bytes received by the UART, polled at the baud rate while the receiver is on
+ @return The next byte, or -1 if none arrived
+*/
+typedef int16_t (*host_uart_source_t)();
+void host_set_uart_source(host_uart_source_t source);
+
+/** Observer of writes to PORTB, e.g. to see chip select edges
+ @param old Value before the write
+ @param now Value after the write
+*/
+typedef void (*host_port_watch_t)(uint8_t old, uint8_t now);
+void host_set_portb_watch(host_port_watch_t watch);
+
+/** Fires the Timer 0 compare interrupt if it is enabled, after the free running ADC did the
+ * conversions which fit in one Timer 0 period (OCR0A+1 counts at the TCCR0B prescaler) and
+ * the UART sent and received the bytes it has time for in one tick at the configured baud
+ * rate. Work has no cycle cost on the host, so both only depend on the ticks, not on the
+ * code that runs in between.
+ */
+void host_timer0_tick();
+
+/** Lets time pass, for _delay_us/_delay_ms. The free running ADC does the conversions which
+ * fit in it, code which waits on the sampler has to pass time like this to see them.
+ @param us Microseconds
+*/
+void host_delay_us(uint32_t us);
+
+/** Sleeps until the next interrupt. Nothing but the tick wakes the CPU up on the host, so
+ * Timer 0 is run up to the compare match and host_timer0_tick fires it. Work has no
+ * cycle cost on the host, so the time slept is the rest of the tick.
+ */
+void host_sleep();
+
+/** Runs pending interrupts if they are enabled. Called on every change that can make one runnable. */
+void host_dispatch();
+
+// Clock the register settings are interpreted with
+#ifndef F_CPU
+#define F_CPU 1000000UL
+#endif
+#define HOST_F_CPU F_CPU
+
+/** Simulated time in microseconds, advanced by _delay_ms/_delay_us */
+extern uint64_t host_time_us;
+
+// ----------------------------------- REGISTER BITS -----------------------------------
+#define SREG_I  7
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+
+#define PD2 2
+
+// SPI
+#define SPIE  7
+#define SPE   6
+#define DORD  5
+#define MSTR  4
+#define CPOL  3
+#define CPHA  2
+#define SPR1  1
+#define SPR0  0
+#define SPIF  7
+#define WCOL  6
+#define SPI2X 0
+
+// ADC
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define ADEN  7
+#define ADSC  6
+#define ADATE 5
+#define ADIF  4
+#define ADIE  3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+// Timer 0
+#define COM0A1 7
+#define COM0A0 6
+#define WGM01  1
+#define WGM00  0
+#define WGM02  3
+#define CS02   2
+#define CS01   1
+#define CS00   0
+#define OCIE0B 2
+#define OCIE0A 1
+#define TOIE0  0
+#define OCF0A  1
+
+// USART 0
+#define RXC0   7
+#define TXC0   6
+#define UDRE0  5
+#define U2X0   1
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0  4
+#define TXEN0  3
+#define UCSZ01 2
+#define UCSZ00 1
+
+// Timer 1
+#define CS12   2
+#define CS11   1
+#define CS10   0
+
+#endif /* __HW_HOST_H__ */
@@ -0,0 +1,199 @@
+/*
+ * link_test.cpp
+ *
+ * Plays two pong_host_link boards against each other in real time, left and right, over a
+ * pty each, and passes the bytes between the two ptys unchanged. Both boards play the whole
+ * game, so they have to end with the same points, and the checksums they compared have to
+ * match: a desync, different points or no compared checksums at all fail.
+ *
+ * Usage: link_test [-t ticks] [-b board]   (or "make check")
+ *  -t ticks   Timer ticks each board runs, default 2000
+ *  -b board   The board program, default ./pong_host_link
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/wait.h>
+
+typedef struct {
+	int master;  // The test's side of the board's pty
+	int slave;   // Kept open, so the master reads nothing instead of failing when the board is done
+	int out;     // The board's stdout
+	pid_t pid;
+	char text[4096]; // What the board printed
+	int len;
+} board_t;
+
+/** Opens a pty in raw mode, so the bytes reach the board unchanged even before it opened it
+ @return 1 if it was opened
+*/
+static int openPty(board_t &b) {
+	b.master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (b.master < 0 || grantpt(b.master) || unlockpt(b.master)) {
+		perror("posix_openpt");
+		return 0;
+	}
+	b.slave = open(ptsname(b.master), O_RDWR | O_NOCTTY);
+	if (b.slave < 0) {
+		perror(ptsname(b.master));
+		return 0;
+	}
+	struct termios t;
+	tcgetattr(b.slave, &t);
+	cfmakeraw(&t);
+	tcsetattr(b.slave, TCSANOW, &t);
+	return 1;
+}
+
+/** Starts a board on its pty, with its stdout on a pipe
+ @return 1 if it was started
+*/
+static int startBoard(board_t &b, const char *program, const char *ticks, int right) {
+	int fds[2];
+	if (pipe(fds)) {
+		perror("pipe");
+		return 0;
+	}
+	b.pid = fork();
+	if (b.pid < 0) {
+		perror("fork");
+		return 0;
+	}
+	if (b.pid == 0) {
+		dup2(fds[1], 1);
+		close(fds[0]);
+		close(fds[1]);
+		const char *args[] = {program, "-r", "-t", ticks, "-l", ptsname(b.master), right ? "-R" : NULL, NULL};
+		execv(program, (char**) args);
+		perror(program);
+		_exit(127);
+	}
+	close(fds[1]);
+	b.out = fds[0];
+	fcntl(b.out, F_SETFL, O_NONBLOCK);
+	b.len = 0;
+	return 1;
+}
+
+/** Reads what the board printed so far, keeps the first sizeof(text) - 1 bytes */
+static void readOutput(board_t &b) {
+	char buf[256];
+	ssize_t n;
+	while ((n = read(b.out, buf, sizeof(buf))) > 0) {
+		int keep = (int) sizeof(b.text) - 1 - b.len;
+		if (keep > n)
+			keep = n;
+		memcpy(b.text + b.len, buf, keep);
+		b.len += keep;
+	}
+	b.text[b.len] = 0;
+}
+
+/** Passes the bytes the board sent on to the other one */
+static void relay(board_t &from, board_t &to) {
+	char buf[256];
+	ssize_t n;
+	while ((n = read(from.master, buf, sizeof(buf))) > 0) {
+		for (ssize_t done = 0; done < n; ) {
+			ssize_t w = write(to.master, buf + done, n - done);
+			if (w > 0)
+				done += w;
+		}
+	}
+}
+
+/** Finds a line of the board's output by its label
+ @return The rest of the line after the label, or NULL
+*/
+static const char *field(const board_t &b, const char *label) {
+	const char *p = strstr(b.text, label);
+	return p ? p + strlen(label) : NULL;
+}
+
+int main(int argc, char **argv) {
+	const char *ticks = "2000", *program = "./pong_host_link";
+	int opt;
+	while ((opt = getopt(argc, argv, "t:b:")) != -1) {
+		switch (opt) {
+			case 't': ticks = optarg; break;
+			case 'b': program = optarg; break;
+			default:
+				fprintf(stderr, "Usage: %s [-t ticks] [-b board]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	board_t boards[2];
+	for (int i=0; i<2; i++) {
+		if (!openPty(boards[i]))
+			return 1;
+		fcntl(boards[i].master, F_SETFL, O_NONBLOCK);
+	}
+	for (int i=0; i<2; i++) {
+		if (!startBoard(boards[i], program, ticks, i))
+			return 1;
+	}
+
+	int running = 2, status[2] = {0, 0};
+	pid_t done[2] = {0, 0};
+	while (running) {
+		struct pollfd fds[4];
+		for (int i=0; i<2; i++) {
+			fds[i].fd = boards[i].master;
+			fds[2+i].fd = boards[i].out;
+			fds[i].events = fds[2+i].events = POLLIN;
+		}
+		poll(fds, 4, 10);
+		relay(boards[0], boards[1]);
+		relay(boards[1], boards[0]);
+		for (int i=0; i<2; i++) {
+			readOutput(boards[i]);
+			if (!done[i] && (done[i] = waitpid(boards[i].pid, &status[i], WNOHANG)) > 0)
+				running--;
+		}
+	}
+	for (int i=0; i<2; i++)
+		readOutput(boards[i]);
+
+	int failed = 0;
+	unsigned matched[2], desyncs[2];
+	for (int i=0; i<2; i++) {
+		const char *name = i ? "right" : "left";
+		const char *checks = field(boards[i], "checksums:");
+		if (!WIFEXITED(status[i]) || WEXITSTATUS(status[i]) != 0 || !checks ||
+			sscanf(checks, "%u matched, %u desyncs", &matched[i], &desyncs[i]) != 2) {
+			printf("link_test: the %s board failed\n%s", name, boards[i].text);
+			return 1;
+		}
+		if (desyncs[i]) {
+			printf("link_test: the %s board counted %u desyncs\n", name, desyncs[i]);
+			failed++;
+		}
+		if (!matched[i]) {
+			printf("link_test: the %s board compared no checksums\n", name);
+			failed++;
+		}
+	}
+	const char *points[2] = {field(boards[0], "points:"), field(boards[1], "points:")};
+	for (int i=0; i<2; i++) {
+		if (points[i])
+			points[i] += strspn(points[i], " ");
+	}
+	int pointsLen = points[0] ? strcspn(points[0], "\n") : 0;
+	if (!points[0] || !points[1] || strncmp(points[0], points[1], pointsLen + 1)) {
+		printf("link_test: the boards ended with different points\n");
+		failed++;
+	}
+
+	if (failed) {
+		printf("%s\n%s", boards[0].text, boards[1].text);
+		return 1;
+	}
+	printf("link_test: both boards ended %.*s, %u and %u checksums matched\n", pointsLen, points[0], matched[0], matched[1]);
+	return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * mkscreens.cpp
+ *
+ * Generates ../screens.cpp: draws the static screens laid out in screens.hpp with the game's
+ * display driver, reads them back from the display model and compresses them for
+ * SSD1306::show_P. Prints the C++ source on stdout and the sizes on stderr.
+ *
+ * Usage: mkscreens > ../screens.cpp   (or "make screens")
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "hw_host.hpp"
+#include "display_host.hpp"
+#include "ssd1306.hpp"
+#include "screens.hpp"
+
+#define SCREEN_BYTES (SSD1306_LCDWIDTH*SSD1306_PAGES)
+#define MAX_RUN 128 // Longest run, literal or repeated, of one control byte
+
+/** Runs of equal bytes pay off from 3 bytes on, shorter ones go in literal runs */
+static std::vector<uint8_t> compress(const uint8_t *screen) {
+	std::vector<uint8_t> out;
+	uint16_t i = 0;
+	while (i < SCREEN_BYTES) {
+		uint16_t n = 1;
+		while (i+n < SCREEN_BYTES && n < MAX_RUN && screen[i+n] == screen[i])
+			n++;
+		if (n >= 3) {
+			out.push_back((n-1) | SSD1306_RLE_RUN);
+			out.push_back(screen[i]);
+			i += n;
+			continue;
+		}
+		// Literal run up to the next repeated run
+		uint16_t start = i;
+		while (i < SCREEN_BYTES && i-start < MAX_RUN) {
+			if (i+2 < SCREEN_BYTES && screen[i] == screen[i+1] && screen[i] == screen[i+2])
+				break;
+			i++;
+		}
+		out.push_back(i-start-1);
+		out.insert(out.end(), screen + start, screen + i);
+	}
+	return out;
+}
+
+/** Decodes like show_P, to check the compression */
+static int matches(const std::vector<uint8_t> &packed, const uint8_t *screen) {
+	uint16_t n = 0;
+	for (size_t i=0; i<packed.size(); ) {
+		uint8_t c = packed[i++];
+		uint8_t len = (c & ~SSD1306_RLE_RUN) + 1;
+		for (uint8_t k=0; k<len; k++, n++) {
+			if (n >= SCREEN_BYTES || screen[n] != packed[c & SSD1306_RLE_RUN ? i : i+k])
+				return 0;
+		}
+		i += c & SSD1306_RLE_RUN ? 1 : len;
+	}
+	return n == SCREEN_BYTES;
+}
+
+static int emit(const char *name, SSD1306 &display) {
+	display.refresh();
+	display.wait();
+	const uint8_t *screen = host_display_gddram();
+	std::vector<uint8_t> packed = compress(screen);
+	if (!matches(packed, screen)) {
+		fprintf(stderr, "%s: compression mismatch\n", name);
+		return 0;
+	}
+	printf("\n// %u bytes of %u\nconst uint8_t %s[] PROGMEM = {", (unsigned)packed.size(), SCREEN_BYTES, name);
+	for (size_t i=0; i<packed.size(); i++)
+		printf("%s0x%02X,", i%16 ? " " : "\n\t", packed[i]);
+	printf("\n};\n");
+	fprintf(stderr, "%-13s %4u bytes of %u\n", name, (unsigned)packed.size(), SCREEN_BYTES);
+	return 1;
+}
+
+int main() {
+	host_display_attach();
+	SSD1306 display;
+	printf("/* Generated by host/mkscreens from the layout in screens.hpp, do not edit. */\n\n");
+	printf("#include \"screens.hpp\"\n");
+
+	display.clear();
+	display.writeStr(SCREEN_TITLE, SCREEN_TITLE_X, SCREEN_TITLE_Y);
+	display.writeStr(SCREEN_AUTHOR, SCREEN_AUTHOR_X, SCREEN_AUTHOR_Y);
+	if (!emit("screenSplash", display))
+		return 1;
+
+	display.clear();
+	display.writeStr(SCREEN_SCORED, SCREEN_SCORED_X, SCREEN_SCORED_Y);
+	if (!emit("screenPoint", display))
+		return 1;
+	return 0;
+}
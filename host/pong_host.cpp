@@ -0,0 +1,241 @@
+/*
+ * pong_host.cpp
+ *
+ * Runs the game headless on the host against scripted paddle input. The game code
+ * (including main.cpp's tick ISR, built with its main() renamed) is the same as on
+ * the target; only the registers behind it are stand-ins, see hw_host.hpp.
+ *
+ * Usage: pong_host [-t ticks] [-s script] [-u file] [-p] [-d] [-r]
+ *  -t ticks   Timer ticks to run, default 1000000
+ *  -s script  Paddle input. Lines of "<tick> <left> <right>" with 10-bit ADC values,
+ *             each held from its tick until the next line. Without a script the
+ *             paddles sweep up and down at different speeds.
+ *  -u file    Write the bytes sent by the UART (telemetry) to a file or pty, at the
+ *             baud rate in simulated time. Decode them with telemetry_decode.
+ *  -p         Physics only: run a physics step per tick, without the main loop drawing
+ *  -d         Print the display memory when done
+ *  -r         Run in real time, one tick per PONG_TICK_US
+ *
+ * pong_host_prof is built with PONG_PROFILE and also prints the profiler sections.
+ * It also has the benchmarks of PONG_BENCH, which -b runs instead of the game.
+ *
+ * pong_host_link is one board of PONG_LINK, and plays the left side unless -R is given.
+ *  -l tty     Send and receive the link frames on a serial port or pty, instead of -u
+ *  -R         Play the right side, as with the side strap grounded
+ * Two of them play each other over a pty pair, e.g. from
+ *   socat pty,raw,echo=0,link=/tmp/left pty,raw,echo=0,link=/tmp/right
+ * with pong_host_link -r -l /tmp/left and pong_host_link -r -R -l /tmp/right.
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <vector>
+
+#include "hw_host.hpp"
+#include "display_host.hpp"
+#include "main.hpp"
+
+// From main.cpp
+extern Pong pong;
+
+typedef struct {
+	uint32_t tick;
+	uint16_t left, right;
+} script_line_t;
+
+static std::vector<script_line_t> script;
+static size_t scriptPos = 0;
+static uint32_t tick = 0;
+
+static uint16_t sweep(uint32_t t, uint32_t period) {
+	uint32_t phase = t % period;
+	uint32_t half = period / 2;
+	return (phase < half ? phase : period - phase) * 1023 / half;
+}
+
+static uint16_t adcInput(uint8_t channel) {
+	if (script.empty())
+		return channel == PONG_L_PIN ? sweep(tick, 97) : sweep(tick, 151);
+	while (scriptPos+1 < script.size() && script[scriptPos+1].tick <= tick)
+		scriptPos++;
+	return channel == PONG_L_PIN ? script[scriptPos].left : script[scriptPos].right;
+}
+
+static int loadScript(const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	script_line_t l;
+	while (fscanf(f, "%u %hu %hu", &l.tick, &l.left, &l.right) == 3)
+		script.push_back(l);
+	fclose(f);
+	return !script.empty();
+}
+
+static void putChar(char c) {
+	putchar(c);
+}
+
+static FILE *uartOut = 0;
+
+static void uartByte(uint8_t b) {
+	fputc(b, uartOut);
+}
+
+#ifdef PONG_LINK
+static int linkFd = -1;
+static uint32_t linkLost = 0; // Bytes the pty had no room for
+
+static void linkByte(uint8_t b) {
+	if (write(linkFd, &b, 1) != 1)
+		linkLost++;
+}
+
+static int16_t linkSource() {
+	uint8_t b;
+	return read(linkFd, &b, 1) == 1 ? b : -1;
+}
+
+static int openLink(const char *path) {
+	linkFd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (linkFd < 0) {
+		perror(path);
+		return 0;
+	}
+	if (isatty(linkFd)) {
+		struct termios t;
+		tcgetattr(linkFd, &t);
+		cfmakeraw(&t);
+		cfsetispeed(&t, B9600);
+		cfsetospeed(&t, B9600);
+		tcsetattr(linkFd, TCSANOW, &t);
+	}
+	host_set_uart_sink(linkByte);
+	host_set_uart_source(linkSource);
+	return 1;
+}
+#endif
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv) {
+	uint32_t ticks = 1000000;
+	int physicsOnly = 0, dump = 0, realTime = 0, right = 0, opt;
+	while ((opt = getopt(argc, argv, "t:s:u:pdbrl:R")) != -1) {
+		switch (opt) {
+			case 't': ticks = strtoul(optarg, 0, 0); break;
+			case 's': if (!loadScript(optarg)) return 1; break;
+			case 'u':
+				uartOut = fopen(optarg, "wb");
+				if (!uartOut) {
+					perror(optarg);
+					return 1;
+				}
+				host_set_uart_sink(uartByte);
+				break;
+			case 'p': physicsOnly = 1; break;
+#ifdef PONG_BENCH
+			case 'b':
+				initProfiler();
+				benchBalls(pong.getDisplay(), putChar);
+				benchDisplay(pong.getDisplay(), putChar);
+				benchSprites(pong.getDisplay(), putChar);
+				return 0;
+#endif
+			case 'd': dump = 1; break;
+			case 'r': realTime = 1; break;
+#ifdef PONG_LINK
+			case 'l': if (!openLink(optarg)) return 1; break;
+			case 'R': right = 1; break;
+#endif
+			default:
+				fprintf(stderr, "Usage: %s [-t ticks] [-s script] [-u file] [-p] [-d] [-r]"
+#ifdef PONG_LINK
+					" [-l tty] [-R]"
+#endif
+					"\n", argv[0]);
+				return 1;
+		}
+	}
+	
+	host_display_attach();
+	host_set_adc_source(adcInput);
+	
+	// Same start up as main() in main.cpp
+	initProfiler();
+	initUART();
+	initADC(PONG_L_PIN, PONG_R_PIN);
+	sei();
+	pong.start();
+#ifdef PONG_LINK
+	PIND.value = right ? 0 : (1<<LINK_SIDE_PIN); // The strap, the pull-up is not modelled
+	linkStart(pong);
+#else
+	(void)right;
+#endif
+	initRefreshInterrupt();
+	host_display_reset_stats();
+	
+	double start = now();
+	for (tick = 0; tick < ticks; tick++) {
+		if (realTime) {
+			double wait = start + tick*PONG_TICK_US*1e-6 - now();
+			if (wait > 0)
+				usleep(wait*1e6);
+		}
+		host_timer0_tick();
+		if (physicsOnly)
+			pong.stepBall();
+		else
+			mainLoop(); // One pass of the main loop per tick
+		schedIdle();
+	}
+	double elapsed = now() - start;
+	sched_stats_t sched = schedStats();
+	telemetry_stats_t telemetry = telemetryStats();
+	if (uartOut)
+		fclose(uartOut);
+	
+	host_display_stats_t stats = host_display_stats();
+	const uint8_t *gddram = host_display_gddram();
+	uint32_t checksum = 0;
+	for (uint16_t i=0; i<SSD1306_LCDWIDTH*SSD1306_PAGES; i++)
+		checksum = checksum*31 + gddram[i];
+	
+	printf("ticks:        %u\n", ticks);
+	printf("steps:        %u (%u overruns, %u ticks dropped)\n", sched.steps, sched.overruns, sched.dropped);
+	printf("renders:      %u (%u skipped)\n", sched.renders, sched.skipped);
+	printf("sleeps:       %u (%u Timer 0 counts)\n", sched.sleeps, sched.slept);
+	printf("time:         %.3f s\n", elapsed);
+	printf("ticks/s:      %.0f\n", ticks/elapsed);
+	printf("spi bytes:    %u (%u command, %u data) in %u selects\n", stats.bytes, stats.commands, stats.data, stats.selects);
+	printf("telemetry:    %u frames (%u dropped)\n", telemetry.sent, telemetry.dropped);
+	printf("points:       %u - %u\n", pong.getPoints(0), pong.getPoints(1));
+#ifdef PONG_LINK
+	link_stats_t link = linkStats();
+	printf("link:         %u frames received (%u bad, %u broken), %u bytes lost, %u resends\n", telemetry.received, telemetry.bad, link.broken, linkLost, link.resends);
+	printf("link ticks:   %u played, %u confirmed, %u stalled\n", link.tick, link.confirmed, link.stalls);
+	printf("rollbacks:    %u (%u ticks played again)\n", link.rollbacks, link.resimulated);
+	printf("checksums:    %u matched, %u desyncs\n", link.checks, link.desyncs);
+#endif
+	adc_latency_t latency = adcLatency();
+	if (latency.reads)
+		printf("pad latency:  %.1f conversions mean, %u to %u (jitter %u)\n",
+			(double)latency.total/latency.reads, latency.min, latency.max, latency.max - latency.min);
+	printf("display hash: %08x\n", checksum);
+	profDump(putChar);
+	if (dump)
+		host_display_print(stdout);
+	return 0;
+}
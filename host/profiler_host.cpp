@@ -0,0 +1,23 @@
+/*
+ * profiler_host.cpp
+ *
+ * Clock of the profiler for the host build (PROF_HOST_CLOCK), in nanoseconds of
+ * CLOCK_MONOTONIC instead of Timer 1 cycles.
+ */ 
+
+#include <time.h>
+#include "profiler.hpp"
+
+#ifdef PONG_PROFILE
+
+void initProfiler() {
+	profReset();
+}
+
+prof_time_t profNow() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (prof_time_t)(ts.tv_sec*1000000000ULL + ts.tv_nsec);
+}
+
+#endif
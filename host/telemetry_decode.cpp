@@ -0,0 +1,117 @@
+/*
+ * telemetry_decode.cpp
+ *
+ * Decodes the telemetry frames sent over the UART (see telemetry.hpp) and prints one
+ * line per record. Reads a recording, a serial port or pty, or stdin.
+ *
+ * Usage: telemetry_decode [file|tty|-]
+ */ 
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "telemetry.hpp"
+
+static const char *sectionNames[PROF_SECTIONS] = {"ADC", "TICK", "STEP", "PADS", "BALL", "FLSH"};
+
+static void printRecord(uint8_t type, const uint8_t *record, uint8_t len) {
+	if (type == TELEMETRY_STATE && len == sizeof(telemetry_state_t)) {
+		telemetry_state_t s;
+		memcpy(&s, record, len);
+		printf("state   tick %5u  ball %6d %6d  vel %6d %6d  spin %6d  pads %3u %4d  %3u %4d  score %u-%u  awake %3u%%\n",
+			s.tick, s.ballX, s.ballY, s.velX, s.velY, s.spin,
+			s.padY[0], s.padVel[0], s.padY[1], s.padVel[1], s.score[0], s.score[1], s.duty);
+	} else if (type == TELEMETRY_PROFILE && len == sizeof(telemetry_profile_t)) {
+		telemetry_profile_t p;
+		memcpy(&p, record, len);
+		printf("profile");
+		for (uint8_t i=0; i<PROF_SECTIONS; i++)
+			printf("  %s %u/%u", sectionNames[i], p.mean[i], p.max[i]);
+		printf("  pad latency %u us, jitter %u us\n", p.padLatency, p.padJitter);
+	} else if (type == TELEMETRY_LINK && len >= 10 && len <= sizeof(telemetry_link_t)) {
+		telemetry_link_t l;
+		memcpy(&l, record, len);
+		printf("link    first %5u  ack %5u  check %5u:%04x  inputs", l.first, l.ack, l.checkTick, l.check);
+		for (uint8_t i=0; i<len-10; i++)
+			printf(" %3u", l.input[i]);
+		printf(l.sum == telemetryLinkSum(&l, len) ? "\n" : "  bad sum\n");
+	} else {
+		printf("unknown type %u, %u bytes\n", type, len);
+	}
+}
+
+// Frame being received: sync, type, length, record, CRC8 over type, length and record
+static uint8_t frame[TELEMETRY_MAX_RECORD + 4];
+static uint16_t n = 0;
+static uint32_t frames = 0, bad = 0, skipped = 0;
+
+static void feed(uint8_t b);
+
+/** Drops the frame being received after its sync byte turned out not to start one. The
+ * next frame can start anywhere after it, so the rest is fed again. */
+static void resync() {
+	uint8_t rest[sizeof(frame)];
+	uint16_t len = n - 1;
+	memcpy(rest, frame+1, len);
+	bad++;
+	skipped++;
+	n = 0;
+	for (uint16_t j=0; j<len; j++)
+		feed(rest[j]);
+}
+
+static void feed(uint8_t b) {
+	if (n == 0 && b != TELEMETRY_SYNC) {
+		skipped++;
+		return;
+	}
+	frame[n++] = b;
+	if (n == 3 && frame[2] > TELEMETRY_MAX_RECORD) {
+		resync();
+		return;
+	}
+	if (n < 4 || n < frame[2] + 4u)
+		return;
+	
+	uint8_t crc = 0;
+	for (uint8_t j=1; j<n-1; j++)
+		crc = telemetryCRC(crc, frame[j]);
+	if (crc != frame[n-1]) {
+		resync();
+		return;
+	}
+	frames++;
+	printRecord(frame[1], frame+3, frame[2]);
+	n = 0;
+}
+
+int main(int argc, char **argv) {
+	int fd = 0;
+	if (argc > 1 && strcmp(argv[1], "-") != 0) {
+		fd = open(argv[1], O_RDONLY | O_NOCTTY);
+		if (fd < 0) {
+			perror(argv[1]);
+			return 1;
+		}
+	}
+	if (isatty(fd)) {
+		struct termios t;
+		tcgetattr(fd, &t);
+		cfmakeraw(&t);
+		cfsetispeed(&t, B9600);
+		tcsetattr(fd, TCSANOW, &t);
+	}
+	
+	uint8_t buf[256];
+	ssize_t got;
+	while ((got = read(fd, buf, sizeof(buf))) > 0) {
+		for (ssize_t i=0; i<got; i++)
+			feed(buf[i]);
+		fflush(stdout);
+	}
+	fprintf(stderr, "%u frames, %u bad, %u bytes skipped\n", frames, bad, skipped);
+	return 0;
+}
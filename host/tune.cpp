@@ -0,0 +1,400 @@
+/*
+ * tune.cpp
+ *
+ * Self-play tuning of the ball's constants. Plays thousands of headless games with the
+ * game's own BallPool, Pad and PadAI, over a pool of threads, for each of a list of
+ * parameter sets, and reports how long the rallies last and how fast the ball moves.
+ *
+ * Usage: tune [-f sets] [-g games] [-j threads] [-l pad] [-r pad] [-n points] [-s seed] [-S]
+ *  -f sets    Parameter sets, one per line:
+ *               <name> <init_speed> <spin_damp> <vel_damp> <spin_gain> <pad_spin> <dvel0..3>
+ *             at a SPEED_SCL of 1, like BallPhysics; dvel0 is the edge of the pad and dvel3
+ *             its middle. Lines starting with # are skipped. Without -f the current
+ *             constants are played against each of them halved and doubled.
+ *  -g games   Games per set, default 1000
+ *  -j threads Worker threads, default one per core
+ *  -l, -r pad Left and right pads: "sweep" (up and down at a random speed) or "ai0" to
+ *             "ai3" (PadAI at that level). Default ai1 against ai2.
+ *  -n points  Points per game, default 11
+ *  -s seed    Start of the random numbers, default 1. Results do not depend on -j.
+ *  -S         Play the first set at 1, 2, 4... threads and print the games per second
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hw_host.hpp"
+#include "ball.hpp"
+#include "pad.hpp"
+#include "ai.hpp"
+#include "Pong.hpp"
+
+// Timer 0 ticks per second, see initRefreshInterrupt
+#define TICK_HZ (1000000.0/PONG_TICK_US)
+// A rally without a point for this long is stopped and served again
+#define STALL_TICKS (uint32_t)(120*TICK_HZ)
+// Largest rally length and vertical speed (pixels per second) kept apart in the histograms
+#define RALLY_BINS 256
+#define SPEED_BINS 1024
+
+typedef struct {
+	std::string name;
+	int16_t initSpeed, spinDamp, velDamp, spinGain, padSpin;
+	int16_t dvel[4];
+} params_t;
+
+/** BallPhysics with constants read at run time, one set per thread */
+struct TunedPhysics {
+	static thread_local int16_t SPIN_DAMP, VEL_DAMP, SPIN_GAIN, PAD_SPIN;
+	static thread_local ball_vel_t INIT_SPEED;
+	static thread_local ball_vel_t DVEL[4];
+
+	/** Scales a parameter set to the game's tick rate, like BallPhysics */
+	static void use(const params_t &p) {
+		SPIN_DAMP = p.spinDamp*PONG_SPEED_SCL;
+		VEL_DAMP = p.velDamp*PONG_SPEED_SCL;
+		SPIN_GAIN = p.spinGain*PONG_SPEED_SCL;
+		INIT_SPEED = ball_vel_t::fromRaw(p.initSpeed/PONG_SPEED_SCL);
+		PAD_SPIN = p.padSpin;
+		for (uint8_t i=0; i<4; i++)
+			DVEL[i] = ball_vel_t::fromRaw(p.dvel[i]/PONG_SPEED_SCL);
+	}
+	static ball_vel_t spinLoss(ball_vel_t spin) {
+		return ball_vel_t::fromRaw(spin.getRaw()/SPIN_DAMP);
+	}
+	static ball_vel_t velLoss(ball_vel_t vel) {
+		return ball_vel_t::fromRaw(vel.getRaw()/VEL_DAMP);
+	}
+	static ball_vel_t spinPush(ball_vel_t spin) {
+		return ball_vel_t::fromRaw(spin.getRaw()/SPIN_GAIN);
+	}
+	static ball_vel_t padSpin(pad_vel_t padVel) {
+		return ball_vel_t::sat(padVel.getRaw()*PAD_SPIN/PONG_SPEED_SCL); // The sweep may go past the range
+	}
+	static ball_vel_t bounceVel(uint8_t edge) {
+		return DVEL[edge];
+	}
+};
+
+thread_local int16_t TunedPhysics::SPIN_DAMP, TunedPhysics::VEL_DAMP, TunedPhysics::SPIN_GAIN, TunedPhysics::PAD_SPIN;
+thread_local ball_vel_t TunedPhysics::INIT_SPEED, TunedPhysics::DVEL[4];
+
+typedef BallPool<1, PONG_SPEED_SCL, TunedPhysics> TunedBalls;
+
+typedef struct {
+	uint32_t games, points, hits, stalls;
+	uint64_t ticks;
+	uint32_t rally[RALLY_BINS]; // Points by number of pad hits
+	uint32_t speed[SPEED_BINS]; // Pad hits by vertical speed after the hit, in pixels per second
+} stats_t;
+
+typedef struct {
+	int8_t level; // PadAI level, or -1 to sweep
+} pad_mode_t;
+
+static std::vector<params_t> sets;
+static uint32_t gamesPerSet = 1000, seed = 1;
+static uint8_t pointsPerGame = 11;
+static pad_mode_t modes[2] = {{1}, {2}};
+
+static uint32_t xorshift(uint32_t &s) {
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	return s;
+}
+
+/** One side of a game: a Pad with its input */
+class Player {
+public:
+	Player(uint8_t x, pad_mode_t mode, uint32_t &rand) :
+		pad(x), ai(x, mode.level < 0 ? 0 : mode.level, (xorshift(rand) & 0xFFFF) | 1), _mode(mode) {
+		_period = 60 + xorshift(rand) % 200;
+		_phase = xorshift(rand) % _period;
+	}
+
+	void update(uint32_t tick, TunedBalls &balls) {
+		if (_mode.level >= 0) {
+			pad.setY(ai.update(balls));
+			return;
+		}
+		// Same triangle as pong_host's scripted input
+		uint32_t phase = (tick + _phase) % _period, half = _period/2;
+		pad.setY((phase < half ? phase : _period - phase) * 1023 / half);
+	}
+
+	Pad pad;
+	PadAI ai;
+
+private:
+	pad_mode_t _mode;
+	uint32_t _period, _phase;
+};
+
+/** Puts the ball back in play from the side of the pad, like Pong::pointMenu */
+static void serve(TunedBalls &balls, Player &server, ball_vel_t velX) {
+	balls.setX(0, server.pad.getX() ? 126 : 1);
+	balls.setY(0, server.pad.getY());
+	balls.setVelX(0, velX);
+	balls.setVelY(0, ball_vel_t::fromRaw(server.pad.getVel().rescale<11, int16_t>().getRaw()));
+}
+
+/** Plays one game of a set, the same on any thread */
+static void play(uint32_t set, uint32_t game, stats_t &stats) {
+	uint32_t rand = seed*2654435761u ^ (set*gamesPerSet + game + 1)*40503u;
+	for (uint8_t i=0; i<4; i++)
+		xorshift(rand);
+	TunedPhysics::use(sets[set]);
+	TunedBalls balls;
+	Player left(0, modes[0], rand), right(127, modes[1], rand);
+	balls.setVelX(0, xorshift(rand) & 1 ? TunedPhysics::INIT_SPEED : -TunedPhysics::INIT_SPEED);
+
+	uint8_t points[2] = {0, 0};
+	uint32_t tick = 0, served = 0, hits = 0, stalls = 0;
+	const double pixPerSec = TICK_HZ/TunedBalls::VEL_SCL/TunedBalls::PIX_SCL;
+	// Two perfect players never end a game, so it also ends after as many stalls as points
+	while (points[0] < pointsPerGame && points[1] < pointsPerGame && stalls < pointsPerGame) {
+		left.update(tick, balls);
+		right.update(tick, balls);
+
+		// Same order as Pong::stepBall
+		balls.stepAll();
+		uint8_t bounced = balls.bounceAll(left.pad);
+		bounced += balls.bounceAll(right.pad);
+		if (bounced) {
+			left.ai.event();
+			right.ai.event();
+			hits++;
+			uint32_t v = abs(balls.getVel(0).y)*pixPerSec;
+			stats.speed[v < SPEED_BINS ? v : SPEED_BINS-1]++;
+		}
+		int8_t point = balls.touchWallsAll();
+		tick++;
+
+		if (point || tick - served >= STALL_TICKS) {
+			if (point) {
+				// A ball out on the right is a point for the left
+				points[point > 0 ? 0 : 1]++;
+				stats.points++;
+				stats.rally[hits < RALLY_BINS ? hits : RALLY_BINS-1]++;
+			} else {
+				stats.stalls++;
+				stalls++;
+			}
+			stats.hits += hits;
+			hits = 0;
+			served = tick;
+			if (point > 0)
+				serve(balls, left, TunedPhysics::INIT_SPEED);
+			else
+				serve(balls, right, -TunedPhysics::INIT_SPEED);
+			left.ai.event();
+			right.ai.event();
+		}
+	}
+	stats.games++;
+	stats.ticks += tick;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/** Plays the games of the first `count` sets on `threads` threads
+ @return Seconds taken
+*/
+static double run(uint32_t count, unsigned threads, std::vector<stats_t> &stats) {
+	std::atomic<uint32_t> next(0);
+	std::vector<std::vector<stats_t> > local(threads, std::vector<stats_t>(count));
+	std::vector<std::thread> pool;
+	double start = now();
+	for (unsigned t=0; t<threads; t++) {
+		pool.push_back(std::thread([&, t]() {
+			memset(&local[t][0], 0, count*sizeof(stats_t));
+			for (uint32_t job; (job = next++) < count*gamesPerSet; )
+				play(job / gamesPerSet, job % gamesPerSet, local[t][job / gamesPerSet]);
+		}));
+	}
+	for (unsigned t=0; t<threads; t++)
+		pool[t].join();
+	double elapsed = now() - start;
+
+	stats.assign(count, stats_t());
+	for (uint32_t s=0; s<count; s++) {
+		memset(&stats[s], 0, sizeof(stats_t));
+		for (unsigned t=0; t<threads; t++) {
+			stats_t &from = local[t][s];
+			stats[s].games += from.games;
+			stats[s].points += from.points;
+			stats[s].hits += from.hits;
+			stats[s].stalls += from.stalls;
+			stats[s].ticks += from.ticks;
+			for (uint16_t i=0; i<RALLY_BINS; i++)
+				stats[s].rally[i] += from.rally[i];
+			for (uint16_t i=0; i<SPEED_BINS; i++)
+				stats[s].speed[i] += from.speed[i];
+		}
+	}
+	return elapsed;
+}
+
+/** Value below which a fraction of a histogram lies */
+static uint32_t percentile(const uint32_t *hist, uint16_t bins, double fraction) {
+	uint64_t total = 0, sum = 0;
+	for (uint16_t i=0; i<bins; i++)
+		total += hist[i];
+	for (uint16_t i=0; i<bins; i++) {
+		sum += hist[i];
+		if (sum > 0 && sum >= fraction*total)
+			return i;
+	}
+	return 0;
+}
+
+static uint32_t highest(const uint32_t *hist, uint16_t bins) {
+	for (uint16_t i=bins; i>0; i--)
+		if (hist[i-1])
+			return i-1;
+	return 0;
+}
+
+static void report(const std::vector<stats_t> &stats) {
+	printf("%-14s %6s  %-22s  %-22s %6s %8s\n", "set", "games",
+		"rally p10/p50/p90/max", "vy px/s p10/p50/p90/max", "stalls", "pts/min");
+	for (uint32_t s=0; s<stats.size(); s++) {
+		const stats_t &st = stats[s];
+		char rally[32], speed[32];
+		snprintf(rally, sizeof(rally), "%u/%u/%u/%u", percentile(st.rally, RALLY_BINS, 0.1),
+			percentile(st.rally, RALLY_BINS, 0.5), percentile(st.rally, RALLY_BINS, 0.9),
+			highest(st.rally, RALLY_BINS));
+		snprintf(speed, sizeof(speed), "%u/%u/%u/%u", percentile(st.speed, SPEED_BINS, 0.1),
+			percentile(st.speed, SPEED_BINS, 0.5), percentile(st.speed, SPEED_BINS, 0.9),
+			highest(st.speed, SPEED_BINS));
+		double minutes = st.ticks/TICK_HZ/60;
+		printf("%-14s %6u  %-22s  %-22s %6u %8.1f\n", sets[s].name.c_str(), st.games, rally, speed,
+			st.stalls, minutes > 0 ? st.points/minutes : 0);
+	}
+}
+
+static int loadSets(const char *path) {
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	char line[256], name[64];
+	while (fgets(line, sizeof(line), f)) {
+		params_t p;
+		int v[9];
+		if (line[0] == '#' || sscanf(line, "%63s %d %d %d %d %d %d %d %d %d", name, &v[0], &v[1],
+				&v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8]) != 10)
+			continue;
+		p.name = name;
+		p.initSpeed = v[0];
+		p.spinDamp = v[1];
+		p.velDamp = v[2];
+		p.spinGain = v[3];
+		p.padSpin = v[4];
+		for (uint8_t i=0; i<4; i++)
+			p.dvel[i] = v[5+i];
+		if (p.spinDamp <= 0 || p.velDamp <= 0 || p.spinGain <= 0 || p.initSpeed < PONG_SPEED_SCL) {
+			fprintf(stderr, "%s: bad set %s\n", path, name);
+			continue;
+		}
+		sets.push_back(p);
+	}
+	fclose(f);
+	return !sets.empty();
+}
+
+/** The constants of BallPhysics, and each of them halved and doubled */
+static void defaultSets() {
+	const params_t base = {"current", 8192, 128, 64, 16, 512, {128*64, 64*64, 16*64, 2*64}};
+	sets.push_back(base);
+	const char *names[] = {"init_speed", "spin_damp", "vel_damp", "spin_gain", "pad_spin", "dvel"};
+	for (uint8_t n=0; n<6; n++) {
+		for (uint8_t twice=0; twice<2; twice++) {
+			params_t p = base;
+			int16_t *field[] = {&p.initSpeed, &p.spinDamp, &p.velDamp, &p.spinGain, &p.padSpin};
+			if (n < 5) {
+				*field[n] = twice ? *field[n]*2 : *field[n]/2;
+			} else {
+				for (uint8_t i=0; i<4; i++)
+					p.dvel[i] = twice ? p.dvel[i]*2 : p.dvel[i]/2;
+			}
+			p.name = std::string(names[n]) + (twice ? "*2" : "/2");
+			sets.push_back(p);
+		}
+	}
+}
+
+static int parseMode(const char *arg, pad_mode_t &mode) {
+	if (!strcmp(arg, "sweep")) {
+		mode.level = -1;
+		return 1;
+	}
+	if (!strncmp(arg, "ai", 2) && arg[2] >= '0' && arg[2] < '0'+AI_LEVELS && !arg[3]) {
+		mode.level = arg[2] - '0';
+		return 1;
+	}
+	fprintf(stderr, "Unknown pad %s, use sweep or ai0 to ai%d\n", arg, AI_LEVELS-1);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	unsigned threads = std::thread::hardware_concurrency();
+	int scaling = 0, opt;
+	if (!threads)
+		threads = 1;
+	while ((opt = getopt(argc, argv, "f:g:j:l:r:n:s:S")) != -1) {
+		switch (opt) {
+			case 'f': if (!loadSets(optarg)) return 1; break;
+			case 'g': gamesPerSet = strtoul(optarg, 0, 0); break;
+			case 'j': threads = strtoul(optarg, 0, 0); break;
+			case 'l': if (!parseMode(optarg, modes[0])) return 1; break;
+			case 'r': if (!parseMode(optarg, modes[1])) return 1; break;
+			case 'n': pointsPerGame = strtoul(optarg, 0, 0); break;
+			case 's': seed = strtoul(optarg, 0, 0); break;
+			case 'S': scaling = 1; break;
+			default:
+				fprintf(stderr, "Usage: %s [-f sets] [-g games] [-j threads] [-l pad] [-r pad] [-n points] [-s seed] [-S]\n", argv[0]);
+				return 1;
+		}
+	}
+	if (sets.empty())
+		defaultSets();
+	if (!threads || !gamesPerSet || !pointsPerGame) {
+		fprintf(stderr, "Need at least one thread, game and point\n");
+		return 1;
+	}
+
+	std::vector<stats_t> stats;
+	if (scaling) {
+		double base = 0;
+		printf("%8s %10s %8s\n", "threads", "games/s", "speedup");
+		for (unsigned t=1; ; t = t*2 < threads ? t*2 : threads) {
+			double rate = gamesPerSet / run(1, t, stats);
+			if (t == 1)
+				base = rate;
+			printf("%8u %10.0f %8.2f\n", t, rate, rate/base);
+			if (t == threads)
+				break;
+		}
+		return 0;
+	}
+
+	double elapsed = run(sets.size(), threads, stats);
+	report(stats);
+	uint32_t games = sets.size()*gamesPerSet;
+	printf("%u games on %u threads in %.2f s: %.0f games/s\n", games, threads, elapsed, games/elapsed);
+	return 0;
+}
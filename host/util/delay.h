@@ -0,0 +1,10 @@
+/* Host stand-in for <util/delay.h>. Delays advance the simulated clock, and the free running ADC with it. */
+#ifndef __HOST_DELAY_H__
+#define __HOST_DELAY_H__
+
+#include "hw_host.hpp"
+
+static inline void _delay_us(double us) { host_delay_us((uint32_t)us); }
+static inline void _delay_ms(double ms) { host_delay_us((uint32_t)(ms*1000)); }
+
+#endif
@@ -0,0 +1,280 @@
+#include "link.hpp"
+
+#ifdef PONG_LINK
+
+#include <util/delay.h>
+#include "Pong.hpp"
+#include "adc.hpp"
+#include "uart.hpp"
+#include "telemetry.hpp"
+
+#define LINK_HISTORY_MASK (LINK_HISTORY-1)
+#define LINK_CHECKS_MASK (LINK_CHECKS-1)
+#define LINK_HEADER (sizeof(telemetry_link_t) - TELEMETRY_LINK_INPUTS) // Bytes of a frame before the inputs
+// A frame of LINK_FRAME_TICKS inputs on the UART, with the sync byte, type, length and CRC
+#define LINK_FRAME_BYTES (4 + LINK_HEADER + LINK_FRAME_TICKS)
+#define LINK_FRAME_AIR_TICKS ((LINK_FRAME_BYTES*10*1000000UL/UART_REAL_BAUD + PONG_TICK_US - 1)/PONG_TICK_US)
+
+// An input waits up to LINK_FRAME_TICKS for its frame, then for the frame to go out. With less delay
+// than that the other board predicts every input and rolls back on each frame.
+static_assert(LINK_DELAY >= LINK_FRAME_TICKS + LINK_FRAME_AIR_TICKS, "LINK_DELAY shorter than an input takes to arrive");
+static_assert(LINK_WINDOW + LINK_DELAY < LINK_HISTORY, "LINK_HISTORY too short for the window");
+
+static Pong *pong;
+static uint8_t side;     // FALSE if this board plays left
+static uint8_t inputPin; // PONG_L_PIN or PONG_R_PIN
+
+// Inputs by tick, of this board and of the other one, readADC/ADC_OVERSAMPLE
+static uint8_t local[LINK_HISTORY], remote[LINK_HISTORY];
+static uint16_t now;        // Next tick to play
+static uint16_t localNext;  // Inputs of this board are read up to this tick
+static uint16_t remoteNext; // Inputs of the other board arrived up to this tick
+static uint16_t peerAck;    // The other board has the inputs of this one up to this tick
+static uint16_t sendNext;   // Next input to send
+static uint8_t arrived[LINK_HISTORY/8]; // Inputs of the other board which arrived after a gap, a bit per tick
+
+// The game before tick confirmed, all ticks before it were played on inputs which arrived
+static pong_state_t snapshot;
+static uint16_t confirmed;
+
+static uint16_t sums[LINK_CHECKS]; // Checksums of the confirmed ticks
+static uint16_t checkedTick;       // Newest tick the other board sent a checksum of
+static uint16_t pendingCheck;      // Its checksum, while that tick is not confirmed here yet
+static uint8_t pending;
+
+static uint8_t framePass; // Ticks since the last frame
+static uint8_t unacked;   // Frames sent since peerAck moved
+static uint8_t dupAcks;   // Frames received since then which acknowledged the same tick
+static uint8_t repair;    // The next frame sends the inputs from peerAck again
+static uint8_t repaired;  // The inputs from peerAck were sent again for the acknowledgements
+static link_stats_t stats;
+
+/** Ticks from b to a, negative if a is before b. Ticks wrap, so they are only compared this way. */
+static inline int16_t ticksFrom(uint16_t a, uint16_t b) {
+	return (int16_t)(a - b);
+}
+
+/** Plays a tick on the inputs of this board and the inputs of the other one, which are
+ * predicted to stay at the last one which arrived */
+static void play(uint16_t t) {
+	uint8_t mine = local[t & LINK_HISTORY_MASK];
+	uint8_t theirs = remote[(ticksFrom(t, remoteNext) < 0 ? t : remoteNext - 1) & LINK_HISTORY_MASK];
+	if (side)
+		pong->stepTick(theirs*ADC_OVERSAMPLE, mine*ADC_OVERSAMPLE);
+	else
+		pong->stepTick(mine*ADC_OVERSAMPLE, theirs*ADC_OVERSAMPLE);
+}
+
+static void compare(uint16_t tick, uint16_t check) {
+	if (sums[tick & LINK_CHECKS_MASK] == check)
+		stats.checks++;
+	else
+		stats.desyncs++;
+}
+
+/** Takes the game after the tick just played, which was played on real inputs only, as the
+ * new snapshot */
+static void confirm() {
+	pong->save(snapshot);
+	confirmed++;
+	sums[confirmed & LINK_CHECKS_MASK] = Pong::checksum(snapshot);
+	if (pending && confirmed == checkedTick) {
+		pending = FALSE;
+		compare(checkedTick, pendingCheck);
+	}
+}
+
+/** Compares a checksum of the other board with the one of the same tick here, or keeps it
+ * until the tick is confirmed here. Frames repeat the checksum until the next tick is
+ * confirmed, each tick is compared once.
+ */
+static void receiveCheck(uint16_t tick, uint16_t check) {
+	if (ticksFrom(tick, checkedTick) <= 0)
+		return;
+	checkedTick = tick;
+	int16_t age = ticksFrom(confirmed, tick);
+	pending = age < 0;
+	if (pending)
+		pendingCheck = check;
+	else if (age < LINK_CHECKS)
+		compare(tick, check);
+}
+
+/** Confirms the ticks played on inputs which arrived since, from the snapshot. If an input
+ * was not the one predicted, the ticks after them are played again as well, otherwise the
+ * game goes back to where it was.
+ @param from remoteNext before the inputs arrived
+ @param predicted The input they were predicted to be
+*/
+static void rollback(uint16_t from, uint8_t predicted) {
+	uint16_t to = ticksFrom(remoteNext, now) < 0 ? remoteNext : now;
+	if (to == confirmed)
+		return;
+	uint8_t wrong = FALSE;
+	for (uint16_t t = from; ticksFrom(t, to) < 0; t++) {
+		if (remote[t & LINK_HISTORY_MASK] != predicted)
+			wrong = TRUE;
+	}
+	
+	pong_state_t live;
+	if (!wrong)
+		pong->save(live);
+	pong->setQuiet(TRUE);
+	pong->load(snapshot);
+	stats.resimulated += ticksFrom(to, confirmed);
+	while (confirmed != to) {
+		play(confirmed);
+		confirm();
+	}
+	if (wrong) {
+		stats.rollbacks++;
+		stats.resimulated += ticksFrom(now, to);
+		for (uint16_t t = to; t != now; t++)
+			play(t);
+	} else {
+		pong->load(live);
+	}
+	pong->setQuiet(FALSE);
+}
+
+/** Takes the frames which arrived: the acknowledgement of the inputs sent, the inputs of the
+ * other board and its checksum */
+static void receive() {
+	union {
+		telemetry_link_t link;
+		uint8_t raw[TELEMETRY_MAX_RECORD];
+	} r;
+	uint8_t type, len;
+	uint16_t from = remoteNext;
+	// Saved first, as the inputs which arrive may take its place in the ring
+	uint8_t predicted = remote[(remoteNext - 1) & LINK_HISTORY_MASK];
+	
+	while ((type = telemetryReceive(r.raw, &len)) != 0) {
+		if (type != TELEMETRY_LINK || len < LINK_HEADER || len > sizeof(telemetry_link_t))
+			continue;
+		telemetry_link_t &f = r.link;
+		if (f.sum != telemetryLinkSum(&f, len)) {
+			stats.broken++;
+			continue;
+		}
+		// The boards are never more than the history apart, so a frame with ticks out of that range
+		// is broken too
+		if (ticksFrom(f.ack, peerAck) < 0 || ticksFrom(f.ack, localNext) > 0 ||
+			ticksFrom(f.first, remoteNext) < -LINK_HISTORY || ticksFrom(f.first, remoteNext) > LINK_HISTORY ||
+			ticksFrom(f.checkTick, confirmed) < -LINK_HISTORY || ticksFrom(f.checkTick, confirmed) > LINK_HISTORY)
+			continue;
+		
+		if (f.ack != peerAck) {
+			peerAck = f.ack;
+			unacked = dupAcks = 0;
+			repaired = FALSE;
+			if (ticksFrom(sendNext, peerAck) < 0)
+				sendNext = peerAck;
+		} else if (sendNext != peerAck && !repaired && ++dupAcks >= LINK_DUP_ACKS) {
+			// The other board keeps missing the same input while later ones arrived, a frame was lost.
+			// Those are sent again once, the acknowledgements which were on their way ask for them too.
+			repair = repaired = TRUE;
+			dupAcks = 0;
+			stats.resends++;
+		}
+		
+		// Inputs after a gap are kept, up to the one which would take the place of the input
+		// predicted from. They are taken when the gap is filled.
+		uint16_t t = f.first;
+		for (uint8_t i=0; i<len - LINK_HEADER; i++, t++) {
+			if (ticksFrom(t, remoteNext) < 0)
+				continue; // Arrived before
+			if (ticksFrom(t, confirmed) >= LINK_HISTORY - 1)
+				break;
+			remote[t & LINK_HISTORY_MASK] = f.input[i];
+			arrived[(t & LINK_HISTORY_MASK) >> 3] |= BV(t & 7);
+		}
+		while (arrived[(remoteNext & LINK_HISTORY_MASK) >> 3] & BV(remoteNext & 7)) {
+			arrived[(remoteNext & LINK_HISTORY_MASK) >> 3] &= ~BV(remoteNext & 7);
+			remoteNext++;
+		}
+		
+		receiveCheck(f.checkTick, f.check);
+	}
+	
+	if (remoteNext != from)
+		rollback(from, predicted);
+}
+
+/** Sends the inputs the other board does not have yet, at most TELEMETRY_LINK_INPUTS of them, or
+ * the oldest of the ones sent again when a frame was lost */
+static void send() {
+	// Frames get lost: when the other board stops acknowledging, send its inputs again
+	if (peerAck != localNext && ++unacked >= LINK_RESEND_FRAMES) {
+		repair = TRUE;
+		unacked = 0;
+		stats.resends++;
+	}
+	
+	uint16_t t = repair ? peerAck : sendNext, end = repair ? sendNext : localNext;
+	telemetry_link_t f;
+	f.first = t;
+	f.ack = remoteNext;
+	f.checkTick = confirmed;
+	f.check = sums[confirmed & LINK_CHECKS_MASK];
+	uint8_t n = 0;
+	for (; n < TELEMETRY_LINK_INPUTS && t != end; n++, t++)
+		f.input[n] = local[t & LINK_HISTORY_MASK];
+	f.sum = telemetryLinkSum(&f, LINK_HEADER + n);
+	// When the frame did not fit, the same inputs go with the next one
+	if (telemetrySend(TELEMETRY_LINK, &f, LINK_HEADER + n)) {
+		if (repair)
+			repair = FALSE;
+		else
+			sendNext = t;
+	}
+}
+
+void linkStart(Pong &game) {
+	DDRD &= ~BV(LINK_SIDE_PIN);
+	PORTD |= BV(LINK_SIDE_PIN); // Pull-up
+	_delay_us(10); // For the pin to charge up through it
+	side = !(PIND & BV(LINK_SIDE_PIN));
+	inputPin = side ? PONG_R_PIN : PONG_L_PIN;
+	pong = &game;
+	
+	// The inputs of the first LINK_DELAY ticks are 0 on both boards, the pads start at the top
+	now = confirmed = 0;
+	localNext = remoteNext = peerAck = sendNext = LINK_DELAY;
+	checkedTick = (uint16_t)-1;
+	game.save(snapshot);
+	sums[0] = Pong::checksum(snapshot);
+	uartStartReceiver();
+}
+
+void linkUpdate(uint8_t steps) {
+	receive();
+	while (steps--) {
+		// Wait when the rollback or the inputs kept for sending again could not reach back far enough
+		if (ticksFrom(now, confirmed) >= LINK_WINDOW || ticksFrom(now + LINK_DELAY + 1, peerAck) > LINK_HISTORY) {
+			stats.stalls++;
+		} else {
+			local[(now + LINK_DELAY) & LINK_HISTORY_MASK] = readADC(inputPin)/ADC_OVERSAMPLE;
+			localNext = now + LINK_DELAY + 1;
+			play(now);
+			now++;
+			// Played on inputs which both arrived, so the snapshot can move along without playing it again
+			if (confirmed + 1 == now && ticksFrom(confirmed, remoteNext) < 0)
+				confirm();
+		}
+		
+		if (++framePass == LINK_FRAME_TICKS) {
+			framePass = 0;
+			send();
+		}
+	}
+}
+
+link_stats_t linkStats() {
+	link_stats_t s = stats;
+	s.tick = now;
+	s.confirmed = confirmed;
+	return s;
+}
+
+#endif
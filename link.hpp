@@ -0,0 +1,72 @@
+#ifndef __LINK_H__
+#define __LINK_H__
+
+#include <avr/io.h>
+
+class Pong; // Pong.hpp includes this file through main.hpp
+
+/* Two boards playing one game over the UART, built with -DPONG_LINK. Each board reads the
+ * pad of its own side and plays both, and the game is the same on both as long as it is
+ * played on the same inputs (see Pong::stepTick), so only the pad inputs are sent.
+ *
+ * An input is read LINK_DELAY ticks before the tick it is played in, which gives it that long
+ * to reach the other board. An input which is later than that is predicted to be the last
+ * one which arrived. When it arrives and was not the prediction, the game is rolled back:
+ * the state of the last tick played on real inputs only is loaded, and the ticks from there
+ * on are played again without drawing. Only that one state is kept, so playing runs ahead
+ * of the other board by at most LINK_WINDOW ticks, then waits for its inputs. Moving the
+ * snapshot up to the inputs which arrived plays those ticks again too, when they were
+ * predicted right the game then goes back to where it was.
+ *
+ * Each frame acknowledges the inputs of the other board which arrived without a gap. Inputs
+ * after a gap are kept until it is filled, and the sender fills it when the same tick is
+ * acknowledged LINK_DUP_ACKS times, or no new one arrived for LINK_RESEND_FRAMES frames,
+ * without sending the inputs after it again.
+ *
+ * Each frame also carries the checksum of the newest confirmed state, which the other board
+ * compares with its own checksum of that tick, so boards which went apart are counted.
+ *
+ * The side is strapped on LINK_SIDE_PIN: open (pulled up) plays left, grounded plays right.
+ * Connect TXD of each board to RXD of the other, and the grounds.
+ */
+
+#if defined(PONG_LINK) && defined(PONG_AI)
+#error "PONG_LINK plays both pads from the boards, build it without PONG_AI"
+#endif
+
+#define LINK_SIDE_PIN PD2
+#define LINK_DELAY 10        // Ticks between reading an input and playing it, see LINK_FRAME_AIR_TICKS
+#define LINK_WINDOW 44       // Most ticks played ahead of the inputs of the other board
+#define LINK_HISTORY 64      // Inputs kept per side, a power of two
+#define LINK_CHECKS 16       // Checksums of confirmed ticks kept, a power of two
+#define LINK_FRAME_TICKS 4   // Ticks between two frames
+#define LINK_DUP_ACKS 2      // Frames acknowledging the same tick before the inputs from there are sent again
+#define LINK_RESEND_FRAMES 3 // Frames sent without a new acknowledgement before they are sent again anyway
+
+typedef struct {
+	uint16_t tick;        // Ticks played
+	uint16_t confirmed;   // Ticks played on the inputs of both boards
+	uint16_t rollbacks;   // Predictions which were wrong
+	uint16_t resimulated; // Ticks played again, to confirm them or after rollbacks
+	uint16_t stalls;      // Ticks waited for the other board
+	uint16_t checks;      // Checksums which matched the other board's
+	uint16_t desyncs;     // Checksums which did not
+	uint16_t broken;      // Frames with a good CRC but not a good sum, see telemetryLinkSum
+	uint16_t resends;     // Frames which sent inputs again, after a frame was lost
+} link_stats_t;
+
+/** Reads the side from its strap and starts the link, after the game was started.
+ @param game The game, from its first tick
+*/
+void linkStart(Pong &game);
+
+/** Takes the frames which arrived, then plays the ticks that passed and sends a frame when it is
+ * time. Call in place of Pong::update.
+ @param steps Ticks that passed, from schedSteps
+*/
+void linkUpdate(uint8_t steps);
+
+/** Gets a copy of the counters */
+link_stats_t linkStats();
+
+#endif /* __LINK_H__ */
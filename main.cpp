@@ -11,9 +11,9 @@ Connection diagram:
 
                         ------
 (Reset)             PC6|01  28|PC5    (RPAD)
-                    PD0|02  27|PC4    (LPAD)
-                    PD1|03  26|PC3
-                    PD2|04  25|PC2
+(RXD, link)         PD0|02  27|PC4    (LPAD)
+(TXD, telemetry)    PD1|03  26|PC3
+(Link side strap)   PD2|04  25|PC2
                     PD3|05  24|PC1
                     PD4|06  23|PC0
                     Vcc|07  22|Gnd
@@ -44,61 +44,95 @@ Pin setup on OLED display with controller SSD1309
 
 #include "main.hpp"
 
-#define REMOVE_REFRESH_INTERRUPT (TIMSK0 = 0)
-#define SET_REFRESH_INTERRUPT (TIMSK0 = BV(OCIE0A))
 Pong pong;
 
-/** ISR on CTC for timer 0
-**/
-ISR(TIMER0_COMPA_vect) {
-	cli();
-	pong.stepBall();
-	sei();
-}
-
-void initADC() {
-	ADMUX = BV(REFS0); // AVcc, Left Adjusted Result
-	ADCSRA |= BV(ADEN) | BV(ADSC); // Enable ADC, Start Conversion
-	while (ADCSRA & BV(ADSC)); // Wait for conversion to complete before continuing
-}
-
-uint16_t readADC(uint8_t pin) {
-	if (pin > 5 && pin != 8 && pin != 0xE && pin != 0xF) // Check that the pin corresponds to a pin which has an ADC connected to it
-		return 0;
-	ADMUX &= 0xF0; // Deselect current pin
-	ADMUX |= pin; // Select pin C0-C5/other source
-	ADCSRA |= BV(ADSC) | 7; // Start Conversion
-	while (ADCSRA & BV(ADSC)); // Wait for conversion to finish
-	return ADC;
+void initRefreshInterrupt(void) {
+	TCCR0A = BV(WGM01); // Clear on timer compare
+	TCCR0B = PongTick::CS; // Prescaler for F_CPU, see clock.hpp
+	OCR0A = PongTick::COUNTS - 1; // One tick every PONG_TICK_US
+	TIMSK0 = BV(OCIE0A); // Compare 0A interrupt
+	schedResync();
 }
 
-uint16_t randVal() {
-	return (readADC(PONG_L_PIN) ^ readADC(PONG_R_PIN));
+void mainLoop(void) {
+	uint8_t steps = schedSteps();
+	if (!steps)
+		return;
+	
+	// Catch up with the ticks that passed: physics steps, or the time on a menu screen
+	{
+		PROFILE(PROF_STEP);
+#ifdef PONG_LINK
+		linkUpdate(steps); // On the inputs of both boards, see link.hpp
+#else
+		pong.update(steps);
+#endif
+	}
+	
+	// Then draw once
+	{
+		PROFILE(PROF_PADS);
+		pong.refreshPads(); // Draw position of pads from ADC values
+	}
+	{
+		PROFILE(PROF_BALL);
+		pong.refreshBall();
+	}
+	{
+		PROFILE(PROF_FLUSH);
+		schedRendered(pong.flush()); // Send this pass' changes in one burst
+	}
+	
+#ifndef PONG_LINK
+	// Telemetry is dropped rather than waited for when the UART falls behind. With PONG_LINK the
+	// link frames take up the UART.
+	static uint8_t passes = 0, records = 0;
+	static sched_stats_t lastRecord;
+	if (++passes == TELEMETRY_PERIOD) {
+		passes = 0;
+		sched_stats_t now = schedStats();
+		pong.sendTelemetry(now.ticks, schedDuty(lastRecord, now));
+		lastRecord = now;
+		if (++records == TELEMETRY_PROFILE_PERIOD) {
+			records = 0;
+			telemetrySendProfile();
+		}
+	}
+#endif
 }
 
-void initRefreshInterrupt(void) {
-	TCCR0A = BV(WGM01); // Clear on timer compare
-	TCCR0B = BV(CS02); // CLK/256
-	OCR0A = 65/SPEED_SCL; // 1 Mhz / 256 / 65 ~ 60 Hz
-	SET_REFRESH_INTERRUPT; // Compare 0A interrupt
+#ifdef PONG_BENCH
+static void benchPut(char c) {
+	while (!uartWrite((const uint8_t*) &c, 1))
+		;
 }
+#endif
 
 int main(void) {
 	
-	initADC();
-	initRefreshInterrupt();
+#ifdef PONG_BENCH
+	initProfiler();
+	initUART();
+	sei();
+	benchBalls(pong.getDisplay(), benchPut);
+	benchDisplay(pong.getDisplay(), benchPut);
+	benchSprites(pong.getDisplay(), benchPut);
+	while (1)
+		;
+#endif
+	initProfiler();
+	initUART();
+	initADC(PONG_L_PIN, PONG_R_PIN);
+	sei(); // The ADC is sampled from its interrupt
 	
-	pong.menu();
+	pong.start();
+#ifdef PONG_LINK
+	linkStart(pong);
+#endif
+	initRefreshInterrupt();
 	
-	sei();
 	while (1) {
-		pong.refreshPads(); // Draw position of pads from ADC values
-		pong.refreshBall();
-		// If someone has made a point, display menu and temporarily deactivate timer
-		if (pong.madePoint(0) != 0) {
-			REMOVE_REFRESH_INTERRUPT;
-			pong.pointMenu();
-			SET_REFRESH_INTERRUPT;
-		}
+		mainLoop();
+		schedIdle(); // Until the next tick, or any interrupt before it
 	}
 }
\ No newline at end of file
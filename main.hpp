@@ -9,14 +9,22 @@
 #ifndef __MAIN_H__
 #define __MAIN_H__
 
-//#define F_CPU 1000000
+#include "clock.hpp"
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
 #include "Pong.hpp"
+#include "adc.hpp"
+#include "scheduler.hpp"
+#include "profiler.hpp"
+#include "uart.hpp"
+#include "telemetry.hpp"
+#include "bench.hpp"
+#include "link.hpp"
 
-void initADC();
-uint16_t readADC(uint8_t pin);
-uint16_t randVal();
+void initRefreshInterrupt(void);
+
+/** One pass of the main loop: runs the physics steps for the ticks that passed, then draws once */
+void mainLoop(void);
 
 #endif /* __MAIN_H__ */
\ No newline at end of file
@@ -1,30 +1,48 @@
 ﻿#include "pad.hpp"
 
 Pad::Pad(uint8_t xPos) : 
-	pos(), avgVel(0) {
-	pos.x = xPos;
-	pos.y = 0;
+	x(xPos), y(), drawnY(PAD_NOT_DRAWN), vel() {
 }
 
 int16_t Pad::getX() {
-	return pos.x;
+	return x;
 }
 
 int16_t Pad::getY() {
-	return pos.y >> 4;
+	return y.toInt();
 }
 
-int16_t Pad::getVel() {
-	return avgVel;
+pad_vel_t Pad::getVel() {
+	return vel;
 }
 
 void Pad::setY(uint16_t yPos) {
-	avgVel = (avgVel * 3 + ((int16_t) yPos - pos.y)) / 4;
-	pos.y = yPos;
+	pad_pos_t to = pad_pos_t::fromRaw(yPos);
+	// The input is averaged by the ADC, so the velocity is the step between two inputs.
+	// A jump of the input moves further than fits, it stops at the limit.
+	vel = pad_vel_t::sat((to - y).getRaw());
+	y = to;
 }
 
 void Pad::refresh(SSD1306& display) {
-	display.vLine(pos.x,0);
-	display.set_block(pos.x, getY()-4, 0xFF);
-	display.refresh(pos.x, 0, pos.x, 63);
+	// Clearing and drawing an unchanged pad would send its column again
+	if (getY() == drawnY)
+		return;
+	drawnY = getY();
+	display.vLine(x,0);
+	display.set_block(x, getY()-4, 0xFF);
+}
+
+void Pad::redraw() {
+	drawnY = PAD_NOT_DRAWN;
+}
+
+void Pad::save(pad_state_t &s) {
+	s.y = y;
+	s.vel = vel;
+}
+
+void Pad::load(const pad_state_t &s) {
+	y = s.y;
+	vel = s.vel;
 }
\ No newline at end of file
@@ -3,26 +3,52 @@
 
 #include <avr/io.h>
 #include "ssd1306.hpp"
+#include "fixed.hpp"
 
 typedef struct {
 	uint8_t x, y;
 } point8_t;
 
+#define PAD_NOT_DRAWN 0xFF
+
 typedef struct {
 	int16_t x, y;
 } point16_t;
 
+// Height of a pad in pixels. The 10-bit input spans the 64 pixels, which leaves 4 bits below a pixel.
+typedef Fixed<4> pad_pos_t;
+// Movement of a pad in pixels per setY
+typedef Fixed<4, int8_t> pad_vel_t;
+
+/** Position and movement of a pad, what a rollback restores */
+typedef struct {
+	pad_pos_t y;
+	pad_vel_t vel;
+} pad_state_t;
+
 class Pad {
 public:
 	Pad(uint8_t xPos);
 	int16_t getX();
 	int16_t getY();
-	int16_t getVel();
+	pad_vel_t getVel();
+	/** Moves the pad to the input, which is filtered already (see readADC)
+	 @param yPos Input from readADC or PadAI, 0 to ADC_MAX
+	*/
 	void setY(uint16_t yPos);
+	/** Draws the pad where it is now, if it moved since it was last drawn
+	*/
 	void refresh(SSD1306& display);
+	/** Makes the next refresh draw the pad, after the display was cleared */
+	void redraw();
+	/** Copies the position and movement. The next refresh draws the pad where a loaded state put it. */
+	void save(pad_state_t &s);
+	void load(const pad_state_t &s);
 private:
-	point16_t pos;
-	int8_t avgVel;
+	uint8_t x;
+	pad_pos_t y;
+	uint8_t drawnY; // Height the pad was last drawn at, PAD_NOT_DRAWN if it has to be drawn
+	pad_vel_t vel; // Of the last setY
 	int8_t points;
 };
 
@@ -0,0 +1,128 @@
+#include "profiler.hpp"
+
+#ifdef PONG_PROFILE
+
+#include <avr/pgmspace.h>
+#include "ssd1306.hpp"
+#include "scheduler.hpp"
+
+#define PROF_NAME_LEN 4
+static const char names[PROF_SECTIONS][PROF_NAME_LEN+1] PROGMEM = {
+	"ADC ", "TICK", "STEP", "PADS", "BALL", "FLSH"
+};
+
+static volatile prof_stats_t sections[PROF_SECTIONS];
+
+#ifndef PROF_HOST_CLOCK
+void initProfiler() {
+	TCCR1A = 0; // Normal mode, counts to 0xFFFF and wraps
+	TCCR1B = BV(CS10); // CLK/1
+	profReset();
+}
+
+prof_time_t profNow() {
+	// The 16-bit read goes through TEMP, which an ISR reading the timer would overwrite
+	uint8_t sreg_save = SREG;
+	cli();
+	prof_time_t t = TCNT1;
+	SREG = sreg_save;
+	return t;
+}
+#endif
+
+void profAdd(uint8_t section, prof_time_t time) {
+	uint8_t sreg_save = SREG;
+	cli();
+	volatile prof_stats_t &s = sections[section];
+	if (!s.count || time < s.min)
+		s.min = time;
+	if (time > s.max)
+		s.max = time;
+	s.total += time;
+	s.count++;
+	SREG = sreg_save;
+}
+
+prof_stats_t profStats(uint8_t section) {
+	prof_stats_t s;
+	uint8_t sreg_save = SREG;
+	cli();
+	s.min = sections[section].min;
+	s.max = sections[section].max;
+	s.total = sections[section].total;
+	s.count = sections[section].count;
+	SREG = sreg_save;
+	return s;
+}
+
+void profReset() {
+	uint8_t sreg_save = SREG;
+	cli();
+	for (uint8_t i=0; i<PROF_SECTIONS; i++) {
+		sections[i].min = sections[i].max = 0;
+		sections[i].total = 0;
+		sections[i].count = 0;
+	}
+	SREG = sreg_save;
+}
+
+static prof_time_t mean(const prof_stats_t &s) {
+	return s.count ? s.total / s.count : 0;
+}
+
+/** Writes a number right aligned, padded with spaces
+ @return Pointer after the last digit
+*/
+static char* putNum(char *str, uint32_t val, uint8_t width) {
+	char *c = str + width;
+	do {
+		*--c = '0' + val%10;
+		val /= 10;
+	} while (val && c > str);
+	while (c > str)
+		*--c = ' ';
+	return str + width;
+}
+
+static char* putName(char *str, uint8_t section) {
+	for (uint8_t i=0; i<PROF_NAME_LEN; i++)
+		*str++ = pgm_read_byte(&names[section][i]);
+	return str;
+}
+
+void profOverlay(SSD1306 &display, uint8_t y) {
+	char line[] = "NAME mmmmmm xxxxxx";
+	for (uint8_t i=0; i<PROF_SECTIONS; i++, y += 8) {
+		prof_stats_t s = profStats(i);
+		char *c = putName(line, i);
+		c = putNum(c, mean(s), 7);
+		putNum(c, s.max, 7);
+		display.patchStr(line, 0, y);
+	}
+	
+	static sched_stats_t since;
+	sched_stats_t now = schedStats();
+	char awake[] = "AWAKE   nnn%";
+	putNum(awake + 8, schedDuty(since, now), 3);
+	display.patchStr(awake, 0, y);
+	since = now;
+}
+
+void profDump(void (*put)(char c)) {
+	const char *header = "sect     count      min     mean      max\n";
+	while (*header)
+		put(*header++);
+	for (uint8_t i=0; i<PROF_SECTIONS; i++) {
+		prof_stats_t s = profStats(i);
+		char line[] = "NAME cccccccc mmmmmmmm aaaaaaaa xxxxxxxx\n";
+		char *c = putName(line, i);
+		c = putNum(c, s.count, 9);
+		c = putNum(c, s.min, 9);
+		c = putNum(c, mean(s), 9);
+		putNum(c, s.max, 9);
+		for (c = line; *c; c++)
+			put(*c);
+	}
+}
+
+#endif /* PONG_PROFILE */
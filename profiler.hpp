@@ -0,0 +1,98 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+class SSD1306;
+
+/* Build with -DPONG_PROFILE to time the sections below. Timer 1 then counts CPU cycles (CLK/1), and
+ * each PROFILE() scope adds the cycles between its start and end to its section. Times include any
+ * interrupt that ran in between, and a section must be shorter than 65536 cycles. Without the flag
+ * PROFILE() is empty and the other functions are empty inlines.
+ */
+
+// Timed sections
+enum {
+	PROF_ADC,   // ADC conversion complete interrupt
+	PROF_TICK,  // Timer 0 tick interrupt
+	PROF_STEP,  // Pong::update: physics steps (or menu time) of one main loop pass
+	PROF_PADS,  // Pong::refreshPads, including readADC
+	PROF_BALL,  // Pong::refreshBall
+	PROF_FLUSH, // SSD1306::flush of one main loop pass
+	PROF_SECTIONS
+};
+
+#ifdef PONG_PROFILE
+
+#ifdef PROF_HOST_CLOCK
+typedef uint32_t prof_time_t;  // Nanoseconds on the host's monotonic clock
+typedef uint64_t prof_total_t;
+#define PROF_UNIT "ns"
+#define PROF_PER_CYCLE 1000 // Profiler units in one cycle at 1 MHz
+#else
+typedef uint16_t prof_time_t;  // CPU cycles
+typedef uint32_t prof_total_t;
+#define PROF_UNIT "cycles"
+#define PROF_PER_CYCLE 1
+#endif
+
+typedef struct {
+	prof_time_t min, max;
+	prof_total_t total;
+	uint32_t count;
+} prof_stats_t;
+
+/** Starts Timer 1 as the cycle counter and clears all sections */
+void initProfiler();
+
+/** Current value of the cycle counter, can be called with interrupts enabled */
+prof_time_t profNow();
+
+/** Adds a measurement to a section
+ @param section One of PROF_*
+ @param time Time spent in the section
+*/
+void profAdd(uint8_t section, prof_time_t time);
+
+/** Gets a copy of the statistics of a section */
+prof_stats_t profStats(uint8_t section);
+
+/** Clears all sections */
+void profReset();
+
+/** Writes the mean and max time of every section, one per text line, and below them the
+ * share of time the CPU was awake since the last overlay
+ @param display Display to write to, straight through patchStr so it can go over a static screen
+ @param y First line to write at
+*/
+void profOverlay(SSD1306 &display, uint8_t y);
+
+/** Prints count, min, mean and max of every section as text
+ @param put Called for every character
+*/
+void profDump(void (*put)(char c));
+
+/** Times the rest of the enclosing scope */
+class ProfScope {
+public:
+	ProfScope(uint8_t section) : _section(section), _start(profNow()) {}
+	~ProfScope() { profAdd(_section, profNow() - _start); }
+private:
+	uint8_t _section;
+	prof_time_t _start;
+};
+
+#define PROFILE(section) ProfScope _profScope(section)
+
+#else
+
+#define PROFILE(section)
+static inline void initProfiler() {}
+static inline void profReset() {}
+static inline void profOverlay(SSD1306 &, uint8_t) {}
+static inline void profDump(void (*)(char)) {}
+
+#endif /* PONG_PROFILE */
+
+#endif /* __PROFILER_H__ */
@@ -0,0 +1,87 @@
+#include <avr/sleep.h>
+#include "scheduler.hpp"
+#include "profiler.hpp"
+
+static volatile uint16_t ticks = 0; // Only ever written by the ISR
+static uint16_t taken = 0;          // Value of ticks when the main loop last took them
+static sched_stats_t stats;
+
+/** ISR on CTC for timer 0. Only advances time, the work is done by the main loop.
+**/
+ISR(TIMER0_COMPA_vect) {
+	PROFILE(PROF_TICK);
+	ticks++;
+}
+
+static uint16_t now() {
+	// Without masking the interrupt: a tick between the two reads of a byte pair shows as a difference
+	uint16_t t;
+	do {
+		t = ticks;
+	} while (t != ticks);
+	return t;
+}
+
+uint8_t schedSteps() {
+	uint16_t t = now();
+	uint16_t due = t - taken;
+	taken = t;
+	stats.ticks += due;
+	if (due > SCHED_MAX_CATCHUP) {
+		stats.overruns++;
+		stats.dropped += due - SCHED_MAX_CATCHUP;
+		due = SCHED_MAX_CATCHUP;
+	}
+	stats.steps += due;
+	return due;
+}
+
+void schedRendered(uint16_t bytes) {
+	if (bytes)
+		stats.renders++;
+	else
+		stats.skipped++;
+}
+
+void schedResync() {
+	taken = now();
+}
+
+void schedIdle() {
+	cli();
+	if (ticks != taken) {
+		sei();
+		return;
+	}
+	uint16_t t0 = ticks;
+	uint8_t c0 = TCNT0;
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	sleep_enable();
+	sei();
+	sleep_cpu(); // Runs before any interrupt sei let through, so a tick cannot slip in between the check and here
+	sleep_disable();
+	
+	cli();
+	uint16_t t1 = ticks;
+	uint8_t c1 = TCNT0;
+	sei();
+	// A compare match still pending when the count was read makes it look negative
+	int32_t counts = (int32_t)(uint16_t)(t1 - t0)*(OCR0A + 1) + c1 - c0;
+	if (counts > 0)
+		stats.slept += counts;
+	stats.sleeps++;
+}
+
+sched_stats_t schedStats() {
+	return stats;
+}
+
+uint8_t schedDuty(const sched_stats_t &from, const sched_stats_t &to) {
+	uint32_t total = (to.ticks - from.ticks)*(uint32_t)(OCR0A + 1);
+	uint32_t slept = to.slept - from.slept;
+	if (!total)
+		return 100;
+	if (slept > total)
+		return 0;
+	return 100 - slept*100/total;
+}
@@ -0,0 +1,49 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+// Most physics steps run in one pass of the main loop. If the loop falls further behind,
+// the extra ticks are dropped and counted as an overrun instead of slowing it down further.
+#define SCHED_MAX_CATCHUP 4
+
+typedef struct {
+	uint32_t ticks;    // Timer ticks taken by the main loop
+	uint32_t steps;    // Physics steps run
+	uint32_t renders;  // Passes which sent changes to the display
+	uint32_t skipped;  // Passes where nothing on screen had changed
+	uint16_t overruns; // Passes which were more than SCHED_MAX_CATCHUP ticks behind
+	uint16_t dropped;  // Ticks dropped by those overruns
+	uint32_t slept;    // Timer 0 counts (PongTick::PRESCALER CPU cycles each) spent asleep in schedIdle
+	uint32_t sleeps;   // Times schedIdle slept
+} sched_stats_t;
+
+/** Takes the ticks that passed since the last call. The tick interrupt only counts time,
+ * the main loop runs one physics step for each tick returned here.
+ @return Number of physics steps to run now, at most SCHED_MAX_CATCHUP
+*/
+uint8_t schedSteps();
+
+/** Counts the render which followed the steps
+ @param bytes Bytes sent to the display, 0 if nothing changed
+*/
+void schedRendered(uint16_t bytes);
+
+/** Forgets ticks which passed before the main loop started, without counting them as an overrun */
+void schedResync();
+
+/** Sleeps in idle mode until the next interrupt (tick, SPI, ADC or UART), unless a tick is
+ * already due. Call when a main loop pass is done; the time slept is counted for schedDuty.
+ */
+void schedIdle();
+
+/** Gets a copy of the counters */
+sched_stats_t schedStats();
+
+/** Share of the time the CPU was awake between two copies of the counters, to within a tick
+ @return Awake time in percent
+*/
+uint8_t schedDuty(const sched_stats_t &from, const sched_stats_t &to);
+
+#endif /* __SCHEDULER_H__ */
@@ -0,0 +1,26 @@
+/* Generated by host/mkscreens from the layout in screens.hpp, do not edit. */
+
+#include "screens.hpp"
+
+// 166 bytes of 1024
+const uint8_t screenSplash[] PROGMEM = {
+	0x05, 0x1F, 0x20, 0x18, 0x20, 0x1F, 0x1C, 0x82, 0x2A, 0x06, 0x04, 0x00, 0x1F, 0x20, 0x20, 0x00,
+	0x1C, 0x82, 0x22, 0x01, 0x20, 0x1C, 0x82, 0x22, 0x06, 0x1C, 0x3C, 0x02, 0x04, 0x02, 0x3C, 0x1C,
+	0x82, 0x2A, 0x00, 0x04, 0x84, 0x00, 0x05, 0x1F, 0x22, 0x22, 0x20, 0x10, 0x1C, 0x82, 0x22, 0x00,
+	0x1C, 0x84, 0x00, 0x00, 0x3E, 0x82, 0x11, 0x01, 0x0E, 0x1E, 0x82, 0x21, 0x0A, 0x1E, 0x3E, 0x01,
+	0x01, 0x02, 0x3C, 0x1E, 0x21, 0x29, 0x29, 0x1A, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00,
+	0xFF, 0x00, 0xB5, 0x00, 0x02, 0x80, 0x00, 0x80, 0x89, 0x00, 0x00, 0x80, 0x89, 0x00, 0x00, 0x80,
+	0x8D, 0x00, 0x84, 0x80, 0xD2, 0x00, 0x05, 0x1F, 0x00, 0x03, 0x00, 0x1F, 0x0E, 0x82, 0x11, 0x01,
+	0x1E, 0x0E, 0x82, 0x11, 0x01, 0x0F, 0x0E, 0x82, 0x15, 0x00, 0x02, 0x84, 0x00, 0x00, 0x0F, 0x82,
+	0x11, 0x01, 0x0E, 0x07, 0x82, 0x28, 0x00, 0x1F, 0x84, 0x00, 0x0A, 0x1F, 0x14, 0x14, 0x10, 0x10,
+	0x1E, 0x01, 0x02, 0x01, 0x1E, 0x0E, 0x82, 0x11, 0x01, 0x1E, 0x0F, 0x82, 0x10, 0x01, 0x0F, 0x12,
+	0x82, 0x15, 0x00, 0x08, 0xBE, 0x00,
+};
+
+// 62 bytes of 1024
+const uint8_t screenPoint[] PROGMEM = {
+	0x02, 0x00, 0x00, 0x12, 0x82, 0x25, 0x01, 0x18, 0x1C, 0x82, 0x22, 0x01, 0x20, 0x1C, 0x82, 0x22,
+	0x01, 0x1C, 0x3C, 0x82, 0x02, 0x01, 0x04, 0x1C, 0x82, 0x2A, 0x01, 0x04, 0x1C, 0x82, 0x22, 0x00,
+	0x1F, 0x84, 0x00, 0x00, 0x1F, 0x82, 0x22, 0x01, 0x1C, 0x0E, 0x82, 0x50, 0x00, 0x3E, 0xFF, 0x00,
+	0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xD0, 0x00,
+};
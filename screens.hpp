@@ -0,0 +1,32 @@
+#ifndef __SCREENS_H__
+#define __SCREENS_H__
+
+#include <avr/pgmspace.h>
+#include <stdint.h>
+#include "5x8_font.hpp"
+
+/* Static screens, compressed for SSD1306::show_P. screens.cpp is generated by host/mkscreens
+ * ("make screens" in host/) from the layout below; regenerate it after changing the layout.
+ */
+
+// Splash screen at power on
+#define SCREEN_TITLE "Welcome to PONG"
+#define SCREEN_TITLE_X 0
+#define SCREEN_TITLE_Y 0
+#define SCREEN_AUTHOR "Made by Emaus"
+#define SCREEN_AUTHOR_X 0
+#define SCREEN_AUTHOR_Y 55
+
+// Frame of the point screen. The scorer and the points are patched in, see Pong::pointMenu.
+// Nothing is drawn in columns 0, 1, 126 and 127, where the pads and the served ball move.
+#define SCREEN_SCORED "Scored by"
+#define SCREEN_SCORED_X 2
+#define SCREEN_SCORED_Y 0
+#define SCREEN_SCORER_X (SCREEN_SCORED_X + 10*FONT_WIDTH)
+#define SCREEN_POINTS_X (60 - 4*3)
+#define SCREEN_POINTS_Y 28
+
+extern const uint8_t screenSplash[] PROGMEM;
+extern const uint8_t screenPoint[] PROGMEM;
+
+#endif /* __SCREENS_H__ */
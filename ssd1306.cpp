@@ -22,16 +22,35 @@ Pin setup on OLED display with controller SSD1309
 */
 
 #include "ssd1306.hpp"
+
+ssd1306_segment_t SSD1306::_queue[SSD1306_QUEUE_LEN];
+uint8_t SSD1306::_cmd[SSD1306_QUEUE_LEN][SSD1306_WINDOW_COST];
+volatile uint8_t SSD1306::_head = 0, SSD1306::_count = 0;
+volatile uint8_t SSD1306::_running = FALSE;
+volatile uint8_t SSD1306::_pageRefs[SSD1306_PAGES];
+const uint8_t *SSD1306::_ptr;
+uint8_t SSD1306::_col, SSD1306::_row;
+
+/** ISR on SPI transfer complete
+**/
+ISR(SPI_STC_vect) {
+	SSD1306::transferComplete();
+}
  
 SSD1306::SSD1306() {
 	clear();
 	initialise();
 }
 
+#ifndef SSD1306_DISPLAY_LIST
 void SSD1306::clear() {
+	wait();
 	memset(_screen, 0, sizeof(uint8_t)*SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8);
+	memset(_dirty, 0xFF, sizeof(_dirty));
 }
  
+#endif
+
 void SSD1306::power(uint8_t b) {
     _command(b?0xAF:0xAE);
 }
@@ -49,13 +68,13 @@ void SSD1306::set_inverse(uint8_t b) {
 }
  
 void SSD1306::set_display_offset(uint8_t offset) {
-    _command(0xD3);
-    _command(offset & 0x3F); 
+    uint8_t cmd[] = {0xD3, (uint8_t)(offset & 0x3F)};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::set_contrast(uint8_t contrast)  {
-    _command(0x81);
-    _command(contrast);
+    uint8_t cmd[] = {0x81, contrast};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::set_display_start_line(uint8_t line) {
@@ -67,8 +86,8 @@ void SSD1306::set_segment_remap(uint8_t b) {
 }
  
 void SSD1306::set_multiplex_ratio(uint8_t ratio) {
-    _command(0xA8);
-    _command(ratio & 0x3F);
+    uint8_t cmd[] = {0xA8, (uint8_t)(ratio & 0x3F)};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::set_com_output_scan_direction(uint8_t b) {
@@ -76,33 +95,31 @@ void SSD1306::set_com_output_scan_direction(uint8_t b) {
 }
  
 void SSD1306::set_com_pins_hardware_configuration(uint8_t sequential, uint8_t left_right_remap) {
-    _command(0xDA);
-    _command(0x02 | ((sequential & 1) << 4) | ((left_right_remap & 1) << 5));
+    uint8_t cmd[] = {0xDA, (uint8_t)(0x02 | ((sequential & 1) << 4) | ((left_right_remap & 1) << 5))};
+    _commands(cmd, sizeof(cmd));
 }
 
 void SSD1306::pam_set_start_address(uint8_t address) {
-    // "Set Lower Column Start Address for Page Addressing Mode"
-    _command(address & 0x0F);
-    
-    // "Set Higher Column Start Address for Page Addressing Mode"
-    _command(0x10 | (address>>4));
+    uint8_t cmd[] = {
+        (uint8_t)(address & 0x0F),      // "Set Lower Column Start Address for Page Addressing Mode"
+        (uint8_t)(0x10 | (address>>4))  // "Set Higher Column Start Address for Page Addressing Mode"
+    };
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::set_memory_addressing_mode(uint8_t mode) {
-    _command(0x20);
-    _command(mode & 0x3);
+    uint8_t cmd[] = {0x20, (uint8_t)(mode & 0x3)};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::hv_set_column_address(uint8_t start, uint8_t end) {
-    _command(0x21);
-    _command(start & 0x7F);
-    _command(end & 0x7F);
+    uint8_t cmd[] = {0x21, (uint8_t)(start & 0x7F), (uint8_t)(end & 0x7F)};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::hv_set_page_address(uint8_t start, uint8_t end) {
-    _command(0x22);
-    _command(start & 0x07);
-    _command(end & 0x07);
+    uint8_t cmd[] = {0x22, (uint8_t)(start & 0x07), (uint8_t)(end & 0x07)};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::pam_set_page_start(uint8_t address) {
@@ -110,18 +127,18 @@ void SSD1306::pam_set_page_start(uint8_t address) {
 }
  
 void SSD1306::set_display_clock_ratio_and_oscillator_frequency(uint8_t ratio, uint8_t frequency) {
-    _command(0xD5);
-    _command((ratio & 0x0F) | (frequency << 4));
+    uint8_t cmd[] = {0xD5, (uint8_t)((ratio & 0x0F) | (frequency << 4))};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::set_precharge_period(uint8_t phase1, uint8_t phase2) {
-    _command(0xD9);
-    _command((phase1 & 0x0F) | (phase2 << 4));
+    uint8_t cmd[] = {0xD9, (uint8_t)((phase1 & 0x0F) | (phase2 << 4))};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::set_vcomh_deselect_level(uint8_t level) {
-    _command(0xDB);
-    _command((level & 0x03) << 4);
+    uint8_t cmd[] = {0xDB, (uint8_t)((level & 0x03) << 4)};
+    _commands(cmd, sizeof(cmd));
 }
  
 void SSD1306::nop() {
@@ -129,50 +146,61 @@ void SSD1306::nop() {
 }
  
 void SSD1306::set_charge_pump_enable(uint8_t enable) {
-    _command(0x8D);
-    _command(enable ? 0x14 : 0x10);
+    uint8_t cmd[] = {0x8D, (uint8_t)(enable ? 0x14 : 0x10)};
+    _commands(cmd, sizeof(cmd));
 }
 
 void SSD1306::set_display_test(uint8_t b) {
     _command(b?0xA5:0xA4);
 }
  
+// Power on configuration, the same as calling the functions in the comments one by one
+static const uint8_t initSequence[] PROGMEM = {
+    0xAE,       // power(FALSE)
+    0xA8, 0x3F, // set_multiplex_ratio(0x3F), 1/64 duty
+    0xD3, 0x00, // set_display_offset(0)
+    0x40,       // set_display_start_line(0)
+    0xA1,       // set_segment_remap(TRUE)
+    0xC8,       // set_com_output_scan_direction(TRUE)
+    0xD9, 0xF1, // set_precharge_period(0x1, 0xF)
+    0xDA, 0x12, // set_com_pins_hardware_configuration(1, 0)
+    0x81, 0x7F, // set_contrast(0x7F)
+    0x20, 0x00, // set_memory_addressing_mode(0), horizontal addressing mode; across then down
+    0xA4,       // set_display_test(FALSE)
+    0xA6,       // set_inverse(FALSE)
+    0xD5, 0xF0, // set_display_clock_ratio_and_oscillator_frequency(0x0, 0xF)
+    0x8D, 0x14, // set_charge_pump_enable(TRUE)
+    0xAF,       // power(TRUE)
+    0x00, 0x10, // pam_set_start_address(0)
+    0xB0,       // pam_set_page_start(0)
+};
+
+const uint8_t SSD1306::CONFIG_BYTES = sizeof(initSequence);
+
 void SSD1306::initialise() {
 	initSPI();
 	
     reset();
-    power(FALSE);
-    
-    set_multiplex_ratio(0x3F); // 1/64 duty
-    set_display_offset(0);
-    set_display_start_line(0);
-    set_segment_remap(TRUE);
-    set_com_output_scan_direction(TRUE);
-    set_precharge_period(0x1, 0xF);
-    set_com_pins_hardware_configuration(1, 0);
-    set_contrast(0x7F);
-    set_memory_addressing_mode(0); // horizontal addressing mode; across then down
-    set_display_test(FALSE);
-    set_inverse(FALSE);
-    set_display_clock_ratio_and_oscillator_frequency(0x0, 0xF);
-    set_charge_pump_enable(TRUE);
-	
-    power(TRUE);
-    
-    pam_set_start_address(0);
-    pam_set_page_start(0);
+    configure();
 	refresh();
 }
 
+void SSD1306::configure() {
+    begin();
+    commands_P(initSequence, sizeof(initSequence));
+    end();
+}
+
 /************************************************************************/
-/* Initializes SPI in master mode with clock/2                          */
+/* Initializes SPI in master mode with the clock divider of clock.hpp   */
 /************************************************************************/
 void SSD1306::initSPI(void) {
     PORT_SSD |= BV(DD_MISO) | BV(DD_RES);
     DDR_SSD |= BV(DD_MOSI) | BV(DD_SCK) | BV(DD_SS) | BV(DD_DC) | BV(DD_RES); // Enable output on MISO, SCK, SS, DC and RES pins
-    SPCR |= BV(SPE) | BV(MSTR); // Enable SPI | Master device | Clock/4
+    SPCR |= BV(SPE) | BV(MSTR); // Enable SPI | Master device
     SPCR |= BV(CPOL) | BV(CPHA); // Mode 3: Setup on falling, sample on rising
-    SPSR |= BV(SPI2X); // Double clock speed => Clock/2
+    SPCR |= CLOCK_SPCR; // Clock/CLOCK_SPI_DIV, Clock/2 up to 20 MHz
+    SPSR |= CLOCK_SPSR;
 }
 
 /***************************************************************************/
@@ -183,33 +211,169 @@ void SSD1306::SPI_send(const uint8_t DATA) {
     while (!(SPSR & BV(SPIF)));
 }
 
-void SSD1306::_command(const uint8_t cmd) {
-    SSD_COMMAND; // Command
+void SSD1306::begin() {
+    wait();
     SPI_SLAVE_SELECT;
+}
+
+void SSD1306::command(uint8_t cmd) {
+    SSD_COMMAND; // Command
     SPI_send(cmd);
-    SPI_SLAVE_DESELECT;
 }
 
-void SSD1306::_data(const uint8_t value) {
+void SSD1306::commands(const uint8_t *cmds, uint8_t len) {
+    SSD_COMMAND;
+    while (len--)
+        SPI_send(*cmds++);
+}
+
+void SSD1306::commands_P(const uint8_t *cmds, uint8_t len) {
+    SSD_COMMAND;
+    while (len--)
+        SPI_send(pgm_read_byte(cmds++));
+}
+
+void SSD1306::data(uint8_t value) {
     SSD_DATA; // Data
-    SPI_SLAVE_SELECT;
     SPI_send(value);
+}
+
+void SSD1306::end() {
     SPI_SLAVE_DESELECT;
 }
 
+void SSD1306::show_P(const uint8_t *screen) {
+    const uint8_t window[SSD1306_WINDOW_COST] = {0x21, 0, SSD1306_LCDWIDTH-1, 0x22, 0, SSD1306_PAGES-1};
+    begin();
+    commands(window, sizeof(window));
+    SSD_DATA;
+    uint16_t left = SSD1306_LCDWIDTH*SSD1306_PAGES;
+    while (left) {
+        uint8_t n = pgm_read_byte(screen++);
+        uint8_t run = n & SSD1306_RLE_RUN;
+        n = (n & ~SSD1306_RLE_RUN) + 1;
+        left -= n;
+        if (run) {
+            uint8_t value = pgm_read_byte(screen++);
+            while (n--)
+                SPI_send(value);
+        } else {
+            while (n--)
+                SPI_send(pgm_read_byte(screen++));
+        }
+    }
+    end();
+    // The display matches the blank buffer nowhere, but only what is drawn from now on is sent over it
+    memset(_dirty, 0, sizeof(_dirty));
+}
+
+void SSD1306::patchStr(const char *c, uint8_t x, uint8_t y) {
+    uint8_t len = strlen(c);
+    uint8_t shift = y%8, page = y/8;
+    uint8_t pages = shift && page < SSD1306_PAGES-1 ? 2 : 1;
+    uint16_t x1 = x + (uint16_t)len*FONT_WIDTH - 1; // Wide, a long string must not wrap back on screen
+    if (!len || x1 >= SSD1306_LCDWIDTH)
+        return;
+    const uint8_t window[SSD1306_WINDOW_COST] = {0x21, x, (uint8_t)x1, 0x22, page, (uint8_t)(page+pages-1)};
+    begin();
+    commands(window, sizeof(window));
+    SSD_DATA;
+    for (uint8_t p=0; p<pages; p++) {
+        for (uint8_t i=0; i<len; i++) {
+            for (uint8_t j=0; j<FONT_WIDTH; j++) {
+                uint8_t block = font(c[i], j);
+                SPI_send(p ? block >> (8-shift) : block << shift);
+            }
+        }
+    }
+    end();
+}
+
+void SSD1306::_commands(const uint8_t *cmds, uint8_t len) {
+    begin();
+    commands(cmds, len);
+    end();
+}
+
+void SSD1306::_command(const uint8_t cmd) {
+    _commands(&cmd, 1);
+}
+
+#ifndef SSD1306_DISPLAY_LIST
+/** Draws bits into a byte in a mode known when compiled */
+template<uint8_t MODE> static inline uint8_t drawBits(uint8_t old, uint8_t bits) {
+	return MODE == SSD1306_SET ? old | bits : MODE == SSD1306_CLEAR ? old & ~bits : old ^ bits;
+}
+
+void SSD1306::_write(uint16_t i, uint8_t val) {
+	if (_screen[i] != val) {
+		_waitPage(i/SSD1306_LCDWIDTH);
+		_screen[i] = val;
+		_dirty[i%SSD1306_LCDWIDTH] |= BV(i/SSD1306_LCDWIDTH);
+	}
+}
+
 void SSD1306::set_pixel(uint8_t x, uint8_t y) {
-	_screen[x + y/8*SSD1306_LCDWIDTH] |= BV(y%8);
+	uint16_t i = x + y/8*SSD1306_LCDWIDTH;
+	_write(i, _screen[i] | BV(y%8));
 }
 
 void SSD1306::clear_pixel(uint8_t x, uint8_t y) {
-	_screen[x + y/8*SSD1306_LCDWIDTH] &= ~BV(y%8);
+	uint16_t i = x + y/8*SSD1306_LCDWIDTH;
+	_write(i, _screen[i] & ~BV(y%8));
 }
 
 void SSD1306::toggle_pixel(uint8_t x, uint8_t y) {
-	_screen[x + y/8*SSD1306_LCDWIDTH] ^= BV(y%8);
+	uint16_t i = x + y/8*SSD1306_LCDWIDTH;
+	_write(i, _screen[i] ^ BV(y%8));
 }
+#endif
 
 void SSD1306::line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t action) {
+	if (y0 == y1 || x0 == x1) {
+		// The pixels up to the end, as the loop below would step through them
+		uint8_t left = x0 < x1 ? x0 : x1, right = x0 < x1 ? x1 : x0;
+		uint8_t top = y0 < y1 ? y0 : y1, bottom = y0 < y1 ? y1 : y0;
+		if (y0 == y1)
+			bottom = top + 1;
+		else
+			right = left + 1;
+		switch (action) {
+			case SSD1306_SET:
+				fillRect<SSD1306_SET>(left, top, right, bottom);
+				break;
+			case SSD1306_CLEAR:
+				fillRect<SSD1306_CLEAR>(left, top, right, bottom);
+				break;
+			default:
+				fillRect<SSD1306_XOR>(left, top, right, bottom);
+		}
+		return;
+	}
+	switch (action) {
+		case SSD1306_SET:
+			_line<SSD1306_SET>(x0, y0, x1, y1);
+			break;
+		case SSD1306_CLEAR:
+			_line<SSD1306_CLEAR>(x0, y0, x1, y1);
+			break;
+		default:
+			_line<SSD1306_XOR>(x0, y0, x1, y1);
+	}
+}
+
+/** Draws a pixel in a mode known when compiled */
+template<uint8_t MODE> static inline void plot(SSD1306 &display, uint8_t x, uint8_t y) {
+	if (MODE == SSD1306_SET)
+		display.set_pixel(x, y);
+	else if (MODE == SSD1306_CLEAR)
+		display.clear_pixel(x, y);
+	else
+		display.toggle_pixel(x, y);
+}
+
+template<uint8_t MODE>
+void SSD1306::_line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
 	int steep = abs(y1 - y0) > abs(x1 - x0);
 	int t;
 	
@@ -237,31 +401,10 @@ void SSD1306::line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t actio
 	}
 	
 	for (; x0<x1; x0++) {
-		if (steep) {
-			switch (action)
-			{
-				case 0:
-				set_pixel(y0, x0);
-				break;
-				case 1:
-				clear_pixel(y0, x0);
-				break;
-				default:
-				toggle_pixel(y0,x0);
-			}
-		} else {
-			switch (action)
-			{
-				case 0:
-				set_pixel(x0, y0);
-				break;
-				case 1:
-				clear_pixel(x0, y0);
-				break;
-				default:
-				toggle_pixel(x0,y0);
-			}
-		}
+		if (steep)
+			plot<MODE>(*this, y0, x0);
+		else
+			plot<MODE>(*this, x0, y0);
 		err -= dy;
 		if (err < 0) {
 			y0 += ystep;
@@ -270,33 +413,69 @@ void SSD1306::line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t actio
 	}
 }
 
+#ifndef SSD1306_DISPLAY_LIST
 void SSD1306::vLine(uint8_t x, uint8_t b) {
 	uint8_t y;
 	for (y = 0; y<8; y++)
-		_screen[x+y*SSD1306_LCDWIDTH] = b;
+		_write(x+y*SSD1306_LCDWIDTH, b);
 }
 
 void SSD1306::set_block(uint8_t x, uint8_t y, uint8_t val) {
 	uint16_t p1 = x + (uint16_t)y / 8 * SSD1306_LCDWIDTH;
 	// Not even multiple of 8
 	if (y%8) {
-		uint16_t p2 = x + (uint16_t)(y / 8 + 1) * SSD1306_LCDWIDTH;
+		// Negative y (wrapped around) only reaches into the first page
+		uint16_t p2 = x + (uint16_t)((y / 8 + 1) % SSD1306_PAGES) * SSD1306_LCDWIDTH;
 		// Set lower part of byte
 		if (y < 64) {
-			_screen[p1] |= val<<(y%8);
-			_screen[p1] &= (val<<(y%8)) | (0xFF>>(8-y%8));
+			_write(p1, (_screen[p1] & (0xFF>>(8-y%8))) | (uint8_t)(val<<(y%8)));
 		}
 		
 		// Set upper part of byte
 		if (y < 64-7 || y > 249) {
-			_screen[p2] |= val>>(8-y%8);
-			_screen[p2] &= (val>>(8-y%8)) | (0xFF<<(y%8));
+			_write(p2, (_screen[p2] & (uint8_t)(0xFF<<(y%8))) | (val>>(8-y%8)));
 		}
 	} else {
-		_screen[p1] = val;
+		_write(p1, val);
 	}
 }
 
+template<uint8_t MODE>
+void SSD1306::fillRect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+	if (x1 > SSD1306_LCDWIDTH)
+		x1 = SSD1306_LCDWIDTH;
+	if (y1 > SSD1306_LCDHEIGHT)
+		y1 = SSD1306_LCDHEIGHT;
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	uint8_t last = (y1 - 1)/8;
+	for (uint8_t page = y0/8; page <= last; page++) {
+		// Rows of the rectangle in this page, all of them between the first and last page
+		uint8_t mask = 0xFF;
+		if (page == y0/8)
+			mask &= 0xFF << (y0%8);
+		if (page == last)
+			mask &= 0xFF >> (7 - (y1 - 1)%8);
+		uint8_t *dst = &_screen[page*SSD1306_LCDWIDTH];
+		uint8_t waited = FALSE;
+		for (uint8_t x = x0; x < x1; x++) {
+			uint8_t val = drawBits<MODE>(dst[x], mask);
+			if (val != dst[x]) {
+				if (!waited) {
+					_waitPage(page);
+					waited = TRUE;
+				}
+				dst[x] = val;
+				_dirty[x] |= BV(page);
+			}
+		}
+	}
+}
+
+template void SSD1306::fillRect<SSD1306_SET>(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+template void SSD1306::fillRect<SSD1306_CLEAR>(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+template void SSD1306::fillRect<SSD1306_XOR>(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
 void SSD1306::writeChar(const char c, uint8_t x, uint8_t y) {
 	uint8_t block;
 	for (uint8_t i = 0; i<5; i++) {
@@ -313,18 +492,71 @@ void SSD1306::writeStr(const char* c, uint8_t x, uint8_t y) {
 	}
 }
 
-void SSD1306::refresh() {
-	uint16_t i;
-	// Set range to whole display
-	hv_set_column_address(0, 127);
-	hv_set_page_address(0, 7);
+void SSD1306::blit_P(const uint8_t *sprite, int16_t x, int16_t y, uint8_t mode) {
+	switch (mode) {
+		case SSD1306_SET:
+			_blit<SSD1306_SET>(sprite, x, y);
+			break;
+		case SSD1306_CLEAR:
+			_blit<SSD1306_CLEAR>(sprite, x, y);
+			break;
+		default:
+			_blit<SSD1306_XOR>(sprite, x, y);
+	}
+}
+
+/* Each page the sprite covers is written once per column. A sprite at y = 8*p0 + s has its band k
+ * (rows 8k..8k+7) shifted down by s, so page p0+k gets the top of band k and the bottom of band k-1.
+ */
+template<uint8_t MODE>
+void SSD1306::_blit(const uint8_t *sprite, int16_t x, int16_t y) {
+	uint8_t w = pgm_read_byte(sprite), h = pgm_read_byte(sprite + 1);
+	const uint8_t *bits = sprite + 2;
+	uint8_t bands = (h + 7)/8;
+	uint8_t lastMask = 0xFF >> (8*bands - h); // Rows of the last band inside the sprite
+	
+	// Columns of the sprite on the screen
+	int16_t c0 = x < 0 ? -x : 0;
+	int16_t c1 = x + w > SSD1306_LCDWIDTH ? SSD1306_LCDWIDTH - x : w;
+	if (h == 0 || c0 >= c1)
+		return;
 	
-	SSD_DATA; // Data
-	SPI_SLAVE_SELECT;
-	for (i=0; i<sizeof(_screen); i++) {
-		SPI_send(_screen[i]);
+	uint8_t s = y & 7;
+	int16_t p0 = y >> 3; // Rounds down, also above the screen
+	int16_t p1 = (y + h - 1) >> 3;
+	for (int16_t page = p0 < 0 ? 0 : p0; page <= p1 && page < SSD1306_PAGES; page++) {
+		uint8_t k = page - p0;
+		const uint8_t *cur = k < bands ? bits + k*w : 0;
+		const uint8_t *prev = s && k > 0 ? bits + (k - 1)*w : 0;
+		uint8_t curMask = k == bands - 1 ? lastMask : 0xFF;
+		uint8_t prevMask = k == bands ? lastMask : 0xFF;
+		uint8_t *dst = &_screen[page*SSD1306_LCDWIDTH + x];
+		uint8_t waited = FALSE;
+		
+		for (int16_t c = c0; c < c1; c++) {
+			uint8_t b = 0;
+			if (cur)
+				b = (uint8_t)((pgm_read_byte(cur + c) & curMask) << s);
+			if (prev)
+				b |= (pgm_read_byte(prev + c) & prevMask) >> (8 - s);
+			
+			uint8_t old = dst[c];
+			uint8_t val = drawBits<MODE>(old, b);
+			if (val != old) {
+				if (!waited) {
+					_waitPage(page);
+					waited = TRUE;
+				}
+				dst[c] = val;
+				_dirty[x + c] |= BV(page);
+			}
+		}
 	}
-	SPI_SLAVE_DESELECT;
+}
+#endif
+
+void SSD1306::refresh() {
+	_window(0, SSD1306_LCDWIDTH-1, 0, SSD1306_PAGES-1);
 }
 
 void SSD1306::refresh(uint8_t x, uint8_t y) {
@@ -335,13 +567,7 @@ void SSD1306::refresh(uint8_t x, uint8_t y) {
 	row = y/8; // [0,63]  => [0,7]
 	row %= 8; // Maximum = 7
 	
-	hv_set_column_address(x, x);
-	hv_set_page_address(row, row);
-	
-	SSD_DATA;
-	SPI_SLAVE_SELECT;
-	SPI_send(_screen[x+row*SSD1306_LCDWIDTH]);
-	SPI_SLAVE_DESELECT;
+	_window(x, x, row, row);
 }
 
 void SSD1306::refresh(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
@@ -367,17 +593,165 @@ void SSD1306::refresh(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
 	row0 %= 8; // Maximum = 7
 	row1 %= 8;
 	
+	_window(x0, x1, row0, row1);
+}
+
+#ifndef SSD1306_DISPLAY_LIST
+uint16_t SSD1306::_window(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+	uint8_t clean = ~((0xFF << page0) & (0xFF >> (7 - page1)));
+	for (uint8_t x=x0; x<=x1; x++) {
+		_dirty[x] &= clean;
+	}
 	
-	hv_set_column_address(x0, x1);
-	hv_set_page_address(row0, row1);
+	// Same as hv_set_column_address(x0, x1) and hv_set_page_address(page0, page1)
+	uint8_t slot = _reserve();
+	uint8_t *cmd = _cmd[slot];
+	cmd[0] = 0x21;
+	cmd[1] = x0 & 0x7F;
+	cmd[2] = x1 & 0x7F;
+	cmd[3] = 0x22;
+	cmd[4] = page0 & 0x07;
+	cmd[5] = page1 & 0x07;
+	_enqueue(cmd, SSD1306_WINDOW_COST, 1, SSD1306_NO_PAGE, FALSE); // Started with the data, in one transaction
+	_enqueue(&_screen[x0+page0*SSD1306_LCDWIDTH], x1-x0+1, page1-page0+1, page0);
+	return SSD1306_WINDOW_COST + (uint16_t)(x1-x0+1)*(page1-page0+1);
+}
+#endif
+
+uint16_t SSD1306::flush() {
+	uint16_t sent = 0;
+	uint8_t open = FALSE;
+	uint8_t x0 = 0, x1 = 0, p0 = 0, p1 = 0;
 	
-	SSD_DATA;
-	SPI_SLAVE_SELECT;
-	uint8_t x,row;
-	for (row=row0; row<=row1; row++) {
-		for (x=x0; x<=x1; x++) {
-			SPI_send(_screen[x+row*SSD1306_LCDWIDTH]);
+	// Sweep the columns left to right, growing one window at a time
+	for (uint8_t x=0; x<SSD1306_LCDWIDTH; x++) {
+		uint8_t pages = _dirty[x];
+		if (!pages)
+			continue;
+		
+		// Dirty page span of this column
+		uint8_t q0 = 0, q1 = SSD1306_PAGES-1;
+		while (!(pages & BV(q0)))
+			q0++;
+		while (!(pages & BV(q1)))
+			q1--;
+		
+		if (open) {
+			// Compare stretching the open window to this column with closing it and opening a new one
+			uint8_t m0 = q0<p0 ? q0 : p0;
+			uint8_t m1 = q1>p1 ? q1 : p1;
+			uint16_t merged = (uint16_t)(x-x0+1)*(m1-m0+1);
+			uint16_t separate = (uint16_t)(x1-x0+1)*(p1-p0+1) + SSD1306_WINDOW_COST + (q1-q0+1);
+			if (merged <= separate) {
+				x1 = x;
+				p0 = m0;
+				p1 = m1;
+				continue;
+			}
+			sent += _window(x0, x1, p0, p1);
 		}
+		x0 = x1 = x;
+		p0 = q0;
+		p1 = q1;
+		open = TRUE;
+	}
+	if (open)
+		sent += _window(x0, x1, p0, p1);
+	return sent;
+}
+
+uint8_t SSD1306::busy() {
+	return _count != 0;
+}
+
+void SSD1306::wait() {
+	while (busy())
+		_poll();
+}
+
+void SSD1306::_waitPage(uint8_t page) {
+	while (_pageRefs[page])
+		_poll();
+}
+
+uint8_t SSD1306::_reserve() {
+	while (_count >= SSD1306_QUEUE_LEN)
+		_poll();
+	// The ISR moves _head and _count together, so read both at once. Their sum, the slot after the
+	// last queued segment, then stays put until _enqueue adds to _count.
+	uint8_t sreg_save = SREG;
+	cli();
+	uint8_t slot = (_head + _count) % SSD1306_QUEUE_LEN;
+	SREG = sreg_save;
+	return slot;
+}
+
+void SSD1306::_poll() {
+	// With interrupts disabled nobody runs the ISR, so feed the transfer from here instead
+	if (!(SREG & BV(SREG_I)) && (SPSR & BV(SPIF)))
+		transferComplete();
+}
+
+void SSD1306::_enqueue(const uint8_t *buf, uint8_t width, uint8_t rows, uint8_t page, uint8_t start) {
+	ssd1306_segment_t *seg = &_queue[_reserve()];
+	seg->buf = buf;
+	seg->width = width;
+	seg->rows = rows;
+	seg->page = page;
+	
+	uint8_t sreg_save = SREG;
+	cli();
+	if (page != SSD1306_NO_PAGE) {
+		for (uint8_t row=0; row<rows; row++)
+			_pageRefs[page+row]++;
+	}
+	_count++;
+	if (start && !_running) {
+		// Engine was idle, start it from the oldest queued segment
+		_running = TRUE;
+		SPI_SLAVE_SELECT;
+		SPCR |= BV(SPIE);
+		_startSegment();
+	}
+	SREG = sreg_save;
+}
+
+void SSD1306::_startSegment() {
+	ssd1306_segment_t *seg = &_queue[_head];
+	_col = 0;
+	_row = 0;
+	_ptr = seg->buf;
+	if (seg->page == SSD1306_NO_PAGE)
+		SSD_COMMAND;
+	else
+		SSD_DATA; // D/C may only change between bytes, which is when this is called
+	SPDR = *_ptr;
+}
+
+void SSD1306::transferComplete() {
+	ssd1306_segment_t *seg = &_queue[_head];
+	if (++_col < seg->width) {
+		SPDR = *++_ptr;
+		return;
+	}
+	
+	// Row done, release its page
+	if (seg->page != SSD1306_NO_PAGE)
+		_pageRefs[seg->page + _row]--;
+	if (++_row < seg->rows) {
+		_col = 0;
+		_ptr += SSD1306_LCDWIDTH - seg->width + 1;
+		SPDR = *_ptr;
+		return;
+	}
+	
+	// Segment done
+	_head = (_head + 1) % SSD1306_QUEUE_LEN;
+	if (--_count) {
+		_startSegment();
+	} else {
+		_running = FALSE;
+		SPCR &= ~BV(SPIE);
+		SPI_SLAVE_DESELECT;
 	}
-	SPI_SLAVE_DESELECT;
 }
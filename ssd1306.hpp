@@ -1,12 +1,73 @@
 #ifndef __SSD1306_H__
 #define __SSD1306_H__
 
-#define F_CPU 1000000UL
+#include "clock.hpp"
 #include <avr/io.h>
 #include <util/delay.h>
+#include <avr/interrupt.h>
 #include <string.h>
 #include "5x8_font.hpp"
 
+#define SSD1306_LCDWIDTH 128
+#define SSD1306_LCDHEIGHT 64
+#define SSD1306_PAGES (SSD1306_LCDHEIGHT/8)
+
+// Command bytes needed to set up a column/page window before sending data
+#define SSD1306_WINDOW_COST 6
+
+/* Define SSD1306_DISPLAY_LIST to build the driver without a frame buffer. The buffer editing functions
+ * then record primitives (pixels, blocks, columns, lines, sprites, text) in a short list instead of writing bits,
+ * and every byte sent to the display is composed from that list while it is sent. This saves about 1 KB
+ * of SRAM, for CPU time spent composing. Drawing is ignored once the list or the text pool is full.
+ */
+#ifdef SSD1306_DISPLAY_LIST
+#define SSD1306_PRIMITIVES 24 // Maximum number of recorded primitives
+#define SSD1306_TEXT_POOL  48 // Characters of text the primitives can hold together
+#endif
+
+// Number of segments the interrupt driven transfer can have queued
+#ifdef SSD1306_DISPLAY_LIST
+#define SSD1306_QUEUE_LEN 1 // Windows are composed while sent, only direct commands use the engine
+#else
+#define SSD1306_QUEUE_LEN 8
+#endif
+
+/** One segment of an interrupt driven transfer. Data segments are a rectangle of the frame buffer
+  * (rows are pages, each row is width bytes of a SSD1306_LCDWIDTH wide buffer), command segments a
+  * single row of command bytes.
+  */
+typedef struct {
+	const uint8_t *buf;
+	uint8_t width;
+	uint8_t rows;
+	uint8_t page; // First page of a data segment, SSD1306_NO_PAGE for commands
+} ssd1306_segment_t;
+#define SSD1306_NO_PAGE 0xFF
+
+#define SSD1306_RLE_RUN 0x80 // Flag of a repeated run in a compressed screen, see show_P
+
+// Drawing modes of blit_P and the spans and fills, the same as the actions of line()
+#define SSD1306_SET   0 // Set the pixels
+#define SSD1306_CLEAR 1 // Clear them
+#define SSD1306_XOR   2 // Toggle them, drawing twice restores what was under them
+
+#ifdef SSD1306_DISPLAY_LIST
+/** A recorded drawing operation. Applied in order to an empty screen they give the screen content. */
+typedef struct {
+	uint8_t type; // SSD1306_PRIM_*
+	uint8_t x;    // (First) column
+	uint8_t y;    // Row of the pixel, or top row of the 8 pixels drawn for each column
+	uint8_t a;    // PIXEL: action, BLOCK: value, COLUMN: pattern, HLINE: end column (excluding), TEXT: pool index, SPRITE: bits
+	uint8_t b;    // HLINE: action, TEXT: length, SPRITE: mode
+} ssd1306_prim_t;
+#define SSD1306_PRIM_PIXEL  0 // set_pixel/clear_pixel/toggle_pixel
+#define SSD1306_PRIM_BLOCK  1 // set_block
+#define SSD1306_PRIM_COLUMN 2 // vLine
+#define SSD1306_PRIM_HLINE  3 // Horizontal line()
+#define SSD1306_PRIM_TEXT   4 // writeStr/writeChar
+#define SSD1306_PRIM_SPRITE 5 // Up to 8 rows of one column of blit_P, or of a fill
+#endif
+
 /** SSD1306 Controller Driver
   *
   */
@@ -19,6 +80,12 @@ public:
  
     /** Initialise the display with defaults.*/
     void initialise();
+    
+    /** Send the power on configuration of initialise(). Streamed from flash in one transaction.*/
+    void configure();
+
+    /** Bytes configure() sends, the length of the power on configuration.*/
+    static const uint8_t CONFIG_BYTES;
 
     /** Send reset to display. Sets all configuration to default. */
     void reset();
@@ -133,6 +200,63 @@ public:
       */
     void set_charge_pump_enable(uint8_t enable);
     
+    // -------------------------------------------- TRANSACTIONS --------------------------------------------
+    // The display stays selected from begin() to end(), so a burst of commands and data selects it only
+    // once. D/C is switched per byte as needed. The configuration functions above are one transaction each.
+    
+    /** Waits for queued transfers to finish, then selects the display.
+      */
+    void begin();
+    
+    /** Sends a command byte. Only between begin() and end().
+      * @param cmd The command byte.
+      */
+    void command(uint8_t cmd);
+    
+    /** Sends a sequence of command bytes. Only between begin() and end().
+      * @param cmds The command bytes.
+      * @param len Number of bytes.
+      */
+    void commands(const uint8_t *cmds, uint8_t len);
+    
+    /** Sends a sequence of command bytes stored in flash (PROGMEM). Only between begin() and end().
+      * @param cmds The command bytes, in flash.
+      * @param len Number of bytes.
+      */
+    void commands_P(const uint8_t *cmds, uint8_t len);
+    
+    /** Sends a byte to GDDRAM. Only between begin() and end().
+      * @param value The data byte.
+      */
+    void data(uint8_t value);
+    
+    /** Deselects the display.
+      */
+    void end();
+    
+    // -------------------------------------------- STATIC SCREENS --------------------------------------------
+    // Screens that never change are kept compressed in flash and decoded straight into the SPI stream, without
+    // drawing them in the buffer. They are the 1024 bytes of the display in the order they are sent (page by
+    // page), as runs: a byte n | SSD1306_RLE_RUN followed by one byte sent n+1 times, or a byte n followed by
+    // n+1 bytes sent as they are. host/mkscreens generates them.
+    
+    /** Shows a compressed screen from flash, blocking until it is sent. The buffer is not drawn in and is
+      * taken to be blank afterwards, so clear() it first. Later drawing replaces the screen's bytes where it
+      * is sent, so static screens leave the columns of the pads and the ball free. Text or overlays over the
+      * screen itself must go through patchStr: drawn in the buffer, they would send its blank bytes around them.
+      * @param screen The compressed screen, in flash.
+      */
+    void show_P(const uint8_t *screen);
+    
+    /** Writes a string straight to the display, around the buffer, for the changing fields of a static screen.
+      * The other rows of the pages the text touches are cleared in its columns. Strings which do not fit on
+      * the line from x are not written.
+      * @param c String to write (ASCII encoded)
+      * @param x X-start position
+      * @param y Y-start position
+      */
+    void patchStr(const char *c, uint8_t x, uint8_t y);
+    
     // -------------------------------------------- BUFFER EDITING --------------------------------------------
 	
 	/** Clears the whole memory buffer
@@ -157,14 +281,39 @@ public:
 	*/
 	void toggle_pixel(uint8_t x, uint8_t y);
 	
-	/** Draws a line in the frame buffer. Display must be refreshed to display the change.
+	/** Draws a line in the frame buffer, up to but not including its end. Horizontal and vertical
+	 lines are drawn as spans. Display must be refreshed to display the change.
 	 @param x0 Line starting X-position
 	 @param y0 Line starting Y-position
 	 @param x1 Line ending X-position
 	 @param y1 Line ending Y-position
+	 @param action SSD1306_SET, SSD1306_CLEAR or SSD1306_XOR
 	*/
 	void line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint8_t action);
 	
+	/** Fills a rectangle in the frame buffer, one masked write per column and page it covers.
+	 The parts off the display are clipped. Display must be refreshed to display the change.
+	 @tparam MODE SSD1306_SET, SSD1306_CLEAR or SSD1306_XOR
+	 With SSD1306_DISPLAY_LIST it takes a primitive per row, or per 8 rows of each column.
+	 @param x0 Left column
+	 @param y0 Top row
+	 @param x1 Column right of the rectangle, up to SSD1306_LCDWIDTH
+	 @param y1 Row below the rectangle, up to SSD1306_LCDHEIGHT
+	*/
+	template<uint8_t MODE> void fillRect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+	
+	/** Draws row y from column x0 up to, but not including, x1, see fillRect. A row off the
+	 display draws nothing. */
+	template<uint8_t MODE> void hSpan(uint8_t x0, uint8_t x1, uint8_t y) {
+		fillRect<MODE>(x0, y, x1, y + 1);
+	}
+	
+	/** Draws column x from row y0 up to, but not including, y1, see fillRect. A column off the
+	 display draws nothing. */
+	template<uint8_t MODE> void vSpan(uint8_t x, uint8_t y0, uint8_t y1) {
+		fillRect<MODE>(x, y0, x + 1, y1);
+	}
+	
 	/** Draws a vertical line (or pattern) in the frame buffer. Display must be refreshed to display the change.
 	 @param x X-position
 	 @param b Byte for each vertical block of 8-pixels
@@ -178,6 +327,18 @@ public:
 	*/
 	void set_block(uint8_t x, uint8_t y, uint8_t val);
 	
+	/** Draws a sprite from flash. A sprite is its width and height in pixels, followed by the
+	 pixels in the layout of the display: (height+7)/8 rows of width bytes, one byte for 8 pixels
+	 of a column with the top pixel in bit 0. Pixels outside the screen are clipped, and only
+	 the set pixels of the sprite are drawn. With SSD1306_DISPLAY_LIST every 8 rows of a column
+	 take a primitive. Display must be refreshed to display the change.
+	 @param sprite The sprite, in flash
+	 @param x X-position of the left column, may be left of or beyond the screen
+	 @param y Y-position of the top row, may be above or below the screen
+	 @param mode SSD1306_SET, SSD1306_CLEAR or SSD1306_XOR
+	*/
+	void blit_P(const uint8_t *sprite, int16_t x, int16_t y, uint8_t mode);
+	
 	/** Writes a character to a specific location on the screen buffer
 	 @param c Character to write (ASCII encoded)
 	 @param x X-start position
@@ -207,19 +368,113 @@ public:
 	 @param y1 Ending Y-position
 	*/
 	void refresh(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+	
+	/** Sends everything that changed in the buffer since the last flush/refresh in one burst.
+	 Dirty areas are sent as few column/page windows as possible; neighbouring areas are merged into
+	 one window when resending the unchanged bytes between them is cheaper than another window setup.
+	 @return Number of bytes (commands and data) sent to the display
+	*/
+	uint16_t flush();
+	
+	// -------------------------------------------- TRANSFER ENGINE --------------------------------------------
+	// refresh() and flush() only queue their windows, which are then sent from the SPI interrupt while the
+	// caller continues. Pages of the frame buffer which are queued or on the wire are locked; drawing into
+	// a locked page waits until the interrupt has sent it, so a transfer never shows a half drawn page.
+	// Commands sent directly (configuration) wait for the queue to drain first.
+	
+	/** Checks if there are queued or ongoing transfers to the display
+	 @return TRUE if the transfer engine is busy
+	*/
+	static uint8_t busy();
+	
+	/** Blocks until every queued transfer has been sent. Also works with interrupts disabled.
+	*/
+	static void wait();
+	
+	/** Sends the next byte of the queue. Only to be called by the SPI transfer complete interrupt.
+	*/
+	static void transferComplete();
  
 private:
+#ifdef SSD1306_DISPLAY_LIST
+    ssd1306_prim_t _prims[SSD1306_PRIMITIVES];
+    uint8_t _nPrims;
+    char _text[SSD1306_TEXT_POOL];
+    uint8_t _nText;
+#else
     uint8_t _screen[1024];
+#endif
+    uint8_t _dirty[SSD1306_LCDWIDTH]; // Bit n is set if page n of the column differs from GDDRAM
  
     void initSPI(void);
     void SPI_send(const uint8_t DATA);
 
+    /** Sends command bytes in a transaction of their own */
+    void _commands(const uint8_t *cmds, uint8_t len);
     void _command(const uint8_t cmd);
-    void _data(const uint8_t value);
+
+    static ssd1306_segment_t _queue[SSD1306_QUEUE_LEN];
+    static uint8_t _cmd[SSD1306_QUEUE_LEN][SSD1306_WINDOW_COST]; // Command bytes of the segment in the same slot
+    static volatile uint8_t _head, _count;
+    static volatile uint8_t _running; // The display is selected and the interrupt is sending the queue
+    static volatile uint8_t _pageRefs[SSD1306_PAGES]; // Queued data segment rows per page (page lock)
+    static const uint8_t *_ptr; // Next byte of the segment being sent
+    static uint8_t _col, _row;
+
+    /** Waits for a free slot in the queue
+     @return Index of the slot the next segment will be queued in
+    */
+    static uint8_t _reserve();
+
+    /** Queues a segment and starts the transfer if the engine is idle. Command segments point into
+     _cmd of the slot returned by _reserve(), which must be filled in first.
+     @param start FALSE to leave an idle engine idle, when the next segment follows right away.
+      Both are then sent in one transaction.
+    */
+    static void _enqueue(const uint8_t *buf, uint8_t width, uint8_t rows, uint8_t page, uint8_t start = 1);
+    static void _startSegment();
+    static void _waitPage(uint8_t page);
+    static void _poll();
+
+#ifdef SSD1306_DISPLAY_LIST
+    /** Records a primitive, dropping earlier primitives it completely draws over
+     @param p Primitive to add. TEXT primitives must already have their characters at the end of the pool.
+    */
+    void _record(const ssd1306_prim_t &p);
+    void _remove(uint8_t i);
+
+    /** Gets what a primitive does to one byte of the screen
+     @param mask Set to the bits the primitive changes
+     @return New value of the changed bits
+    */
+    static uint8_t _effect(const ssd1306_prim_t &p, const char *text, uint8_t x, uint8_t page, uint8_t &mask);
+    
+    /** Pages of column x which a PIXEL, BLOCK, COLUMN or HLINE primitive changes */
+    static uint8_t _pages(const ssd1306_prim_t &p, uint8_t x);
+    
+    /** Composes one byte of the screen from all primitives */
+    uint8_t _compose(uint8_t x, uint8_t page);
+    
+    /** Marks the area of a primitive dirty */
+    void _touch(const ssd1306_prim_t &p);
+
+    /** Records a horizontal line from x0 up to, but not including, x1 */
+    void _hLine(uint8_t x0, uint8_t x1, uint8_t y, uint8_t action);
+#else
+    /** Writes a byte to the frame buffer and marks it as dirty if it changed */
+    void _write(uint16_t i, uint8_t val);
+    
+    template<uint8_t MODE> void _blit(const uint8_t *sprite, int16_t x, int16_t y);
+#endif
+
+    /** Steps through the pixels of a line which is not horizontal or vertical */
+    template<uint8_t MODE> void _line(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+    /** Sends a window of the frame buffer to the display and marks it as clean
+     @return Number of bytes sent
+    */
+    uint16_t _window(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1);
 };
- 
-#define SSD1306_LCDWIDTH 128
-#define SSD1306_LCDHEIGHT 64
 
 // PINs for SSD/SPI
 #define DDR_SSD  DDRB
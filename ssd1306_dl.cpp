@@ -0,0 +1,320 @@
+/*
+ * Buffer editing without a frame buffer (SSD1306_DISPLAY_LIST), see ssd1306.hpp.
+ *
+ * Each drawing call is recorded as a primitive. Applying the primitives in order to an
+ * empty screen gives the same content a frame buffer would have had. When a new primitive
+ * draws over all bits of an earlier one (a pad column redrawn, a pixel cleared), the earlier
+ * one is dropped, so the list stays as short as what is actually on the screen.
+ */
+
+#include "ssd1306.hpp"
+
+#ifdef SSD1306_DISPLAY_LIST
+
+#define SINGLE_COLUMN(p) ((p).type <= SSD1306_PRIM_COLUMN || (p).type == SSD1306_PRIM_SPRITE)
+// Pixels, lines and sprites drawn with action 2 toggle, everything else replaces the bits
+#define TOGGLES(p) (((p).type == SSD1306_PRIM_PIXEL && (p).a == 2) || \
+	((p).type == SSD1306_PRIM_HLINE && (p).b == 2) || ((p).type == SSD1306_PRIM_SPRITE && (p).b == SSD1306_XOR))
+
+/** Gets which bits of a page an 8 pixel high block at row y changes, like set_block does
+ @param val Byte drawn at y
+ @param mask Set to the changed bits
+ @return New value of the changed bits
+*/
+static uint8_t blockEffect(uint8_t val, uint8_t y, uint8_t page, uint8_t &mask) {
+	uint8_t s = y%8;
+	if (!s) {
+		mask = (y < 64 && page == y/8) ? 0xFF : 0;
+		return val;
+	}
+	if (y < 64 && page == y/8) {
+		mask = 0xFF << s;
+		return val << s;
+	}
+	// Negative y (wrapped around) only reaches into the first page
+	if ((y < 64-7 || y > 249) && page == (y/8 + 1) % SSD1306_PAGES) {
+		mask = 0xFF >> (8-s);
+		return val >> (8-s);
+	}
+	mask = 0;
+	return 0;
+}
+
+uint8_t SSD1306::_effect(const ssd1306_prim_t &p, const char *text, uint8_t x, uint8_t page, uint8_t &mask) {
+	mask = 0;
+	switch (p.type) {
+		case SSD1306_PRIM_PIXEL:
+			if (x == p.x && page == p.y/8)
+				mask = BV(p.y%8);
+			return p.a == 0 ? mask : 0;
+		case SSD1306_PRIM_BLOCK:
+			if (x != p.x)
+				return 0;
+			return blockEffect(p.a, p.y, page, mask);
+		case SSD1306_PRIM_COLUMN:
+			if (x == p.x)
+				mask = 0xFF;
+			return p.a;
+		case SSD1306_PRIM_HLINE:
+			if (x >= p.x && x < p.a && page == p.y/8)
+				mask = BV(p.y%8);
+			return p.b == 0 ? mask : 0;
+		case SSD1306_PRIM_TEXT: {
+			uint8_t offset = x - p.x; // Wraps for columns left of the text
+			if (offset >= FONT_WIDTH*p.b)
+				return 0;
+			uint8_t c = text[p.a + offset/FONT_WIDTH];
+			return blockEffect(font(c, offset%FONT_WIDTH), p.y, page, mask);
+		}
+		case SSD1306_PRIM_SPRITE: {
+			if (x != p.x)
+				return 0;
+			// Only the set bits of the sprite are drawn. blockEffect sets mask, so it has to be
+			// called before mask is read.
+			uint8_t bits = blockEffect(p.a, p.y, page, mask);
+			mask &= bits;
+			return p.b == SSD1306_SET ? mask : 0;
+		}
+	}
+	return 0;
+}
+
+uint8_t SSD1306::_pages(const ssd1306_prim_t &p, uint8_t x) {
+	uint8_t pages = 0, mask;
+	for (uint8_t page=0; page<SSD1306_PAGES; page++) {
+		_effect(p, 0, x, page, mask);
+		if (mask)
+			pages |= BV(page);
+	}
+	return pages;
+}
+
+uint8_t SSD1306::_compose(uint8_t x, uint8_t page) {
+	uint8_t v = 0, mask, bits;
+	for (uint8_t i=0; i<_nPrims; i++) {
+		const ssd1306_prim_t &p = _prims[i];
+		bits = _effect(p, _text, x, page, mask);
+		if (TOGGLES(p))
+			v ^= mask;
+		else
+			v = (v & ~mask) | (bits & mask);
+	}
+	return v;
+}
+
+void SSD1306::_touch(const ssd1306_prim_t &p) {
+	// All columns of a primitive cover the same pages, find them from a single column stand-in
+	ssd1306_prim_t column = p;
+	uint16_t x1 = p.x + 1;
+	if (p.type == SSD1306_PRIM_HLINE) {
+		column.type = SSD1306_PRIM_PIXEL;
+		x1 = p.a;
+	} else if (p.type == SSD1306_PRIM_TEXT) {
+		column.type = SSD1306_PRIM_BLOCK;
+		x1 = p.x + FONT_WIDTH*p.b;
+	}
+	uint8_t pages = _pages(column, p.x);
+	for (uint16_t x=p.x; x<x1 && x<SSD1306_LCDWIDTH; x++)
+		_dirty[x] |= pages;
+}
+
+void SSD1306::_remove(uint8_t i) {
+	_touch(_prims[i]);
+	_nPrims--;
+	for (; i<_nPrims; i++)
+		_prims[i] = _prims[i+1];
+}
+
+void SSD1306::_record(const ssd1306_prim_t &p) {
+	uint8_t i, page, mask, pMask;
+	if (SINGLE_COLUMN(p) && !TOGGLES(p)) {
+		// Drop earlier primitives in the same column whose bits are all drawn over by this one
+		for (i=_nPrims; i-- > 0;) {
+			const ssd1306_prim_t &q = _prims[i];
+			if (!SINGLE_COLUMN(q) || q.x != p.x)
+				continue;
+			for (page=0; page<SSD1306_PAGES; page++) {
+				_effect(q, _text, p.x, page, mask);
+				_effect(p, _text, p.x, page, pMask);
+				if (mask & ~pMask)
+					break;
+			}
+			if (page == SSD1306_PAGES)
+				_remove(i);
+		}
+		
+		// Clearing bits nothing else draws on leaves them as they are, empty
+		uint8_t bits = 0, drawn = 0;
+		for (page=0; page<SSD1306_PAGES; page++) {
+			bits |= _effect(p, _text, p.x, page, pMask) & pMask;
+			for (i=0; i<_nPrims; i++) {
+				_effect(_prims[i], _text, p.x, page, mask);
+				drawn |= mask & pMask;
+			}
+		}
+		if (!bits && !drawn)
+			return;
+	}
+	
+	if (_nPrims == SSD1306_PRIMITIVES)
+		return; // Full, the drawing is lost
+	_prims[_nPrims++] = p;
+	_touch(p);
+}
+
+void SSD1306::clear() {
+	_nPrims = 0;
+	_nText = 0;
+	memset(_dirty, 0xFF, sizeof(_dirty));
+}
+
+void SSD1306::set_pixel(uint8_t x, uint8_t y) {
+	ssd1306_prim_t p = {SSD1306_PRIM_PIXEL, x, y, 0, 0};
+	_record(p);
+}
+
+void SSD1306::clear_pixel(uint8_t x, uint8_t y) {
+	ssd1306_prim_t p = {SSD1306_PRIM_PIXEL, x, y, 1, 0};
+	_record(p);
+}
+
+void SSD1306::toggle_pixel(uint8_t x, uint8_t y) {
+	// Toggling twice in a row is no change
+	if (_nPrims) {
+		const ssd1306_prim_t &q = _prims[_nPrims-1];
+		if (q.type == SSD1306_PRIM_PIXEL && q.a == 2 && q.x == x && q.y == y) {
+			_remove(_nPrims-1);
+			return;
+		}
+	}
+	ssd1306_prim_t p = {SSD1306_PRIM_PIXEL, x, y, 2, 0};
+	_record(p);
+}
+
+void SSD1306::_hLine(uint8_t x0, uint8_t x1, uint8_t y, uint8_t action) {
+	if (x0 > x1) {
+		uint8_t t = x0;
+		x0 = x1;
+		x1 = t;
+	}
+	if (x0 == x1)
+		return;
+	ssd1306_prim_t p = {SSD1306_PRIM_HLINE, x0, y, x1, (uint8_t)(action > 2 ? 2 : action)};
+	_record(p);
+}
+
+/* A rectangle is recorded as a line per row or as 8-row SPRITE pieces per column, whichever
+ * takes fewer primitives. */
+template<uint8_t MODE>
+void SSD1306::fillRect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+	if (x1 > SSD1306_LCDWIDTH)
+		x1 = SSD1306_LCDWIDTH;
+	if (y1 > SSD1306_LCDHEIGHT)
+		y1 = SSD1306_LCDHEIGHT;
+	if (x0 >= x1 || y0 >= y1)
+		return;
+	uint8_t pieces = (y1 - y0 + 7)/8;
+	if (y1 - y0 <= (x1 - x0)*pieces) {
+		for (uint8_t y = y0; y < y1; y++)
+			_hLine(x0, x1, y, MODE);
+		return;
+	}
+	for (uint8_t x = x0; x < x1; x++) {
+		for (uint8_t y = y0; y < y1; y += 8) {
+			uint8_t rows = y1 - y < 8 ? y1 - y : 8;
+			ssd1306_prim_t p = {SSD1306_PRIM_SPRITE, x, y, (uint8_t)(0xFF >> (8 - rows)), MODE};
+			_record(p);
+		}
+	}
+}
+
+template void SSD1306::fillRect<SSD1306_SET>(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+template void SSD1306::fillRect<SSD1306_CLEAR>(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+template void SSD1306::fillRect<SSD1306_XOR>(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+void SSD1306::vLine(uint8_t x, uint8_t b) {
+	ssd1306_prim_t p = {SSD1306_PRIM_COLUMN, x, 0, b, 0};
+	_record(p);
+}
+
+void SSD1306::set_block(uint8_t x, uint8_t y, uint8_t val) {
+	ssd1306_prim_t p = {SSD1306_PRIM_BLOCK, x, y, val, 0};
+	_record(p);
+}
+
+void SSD1306::blit_P(const uint8_t *sprite, int16_t x, int16_t y, uint8_t mode) {
+	uint8_t w = pgm_read_byte(sprite), h = pgm_read_byte(sprite + 1);
+	uint8_t bands = (h + 7)/8;
+	for (uint8_t k=0; k<bands; k++) {
+		int16_t top = y + 8*k;
+		if (top <= -8 || top >= SSD1306_LCDHEIGHT)
+			continue;
+		uint8_t keep = k == bands - 1 ? 0xFF >> (8*bands - h) : 0xFF;
+		for (uint8_t c=0; c<w; c++) {
+			int16_t col = x + c;
+			if (col < 0 || col >= SSD1306_LCDWIDTH)
+				continue;
+			uint8_t val = pgm_read_byte(sprite + 2 + k*w + c) & keep;
+			uint8_t row = top;
+			if (top < 0) {
+				// Rows above the screen are dropped here, so the band starts in the first page
+				val >>= -top;
+				row = 0;
+			}
+			if (!val)
+				continue;
+			ssd1306_prim_t p = {SSD1306_PRIM_SPRITE, (uint8_t)col, row, val, mode};
+			_record(p);
+		}
+	}
+}
+
+void SSD1306::writeChar(const char c, uint8_t x, uint8_t y) {
+	char str[2] = {c, 0};
+	writeStr(str, x, y);
+}
+
+void SSD1306::writeStr(const char* c, uint8_t x, uint8_t y) {
+	uint8_t len = strlen(c);
+	if (_nText + len > SSD1306_TEXT_POOL) {
+		// Reclaim the text of dropped primitives
+		uint8_t used = 0;
+		for (uint8_t i=0; i<_nPrims; i++) {
+			ssd1306_prim_t &p = _prims[i];
+			if (p.type != SSD1306_PRIM_TEXT)
+				continue;
+			memmove(&_text[used], &_text[p.a], p.b);
+			p.a = used;
+			used += p.b;
+		}
+		_nText = used;
+		if (_nText + len > SSD1306_TEXT_POOL)
+			return; // Full, the text is lost
+	}
+	memcpy(&_text[_nText], c, len);
+	ssd1306_prim_t p = {SSD1306_PRIM_TEXT, x, y, _nText, len};
+	_nText += len;
+	_record(p);
+}
+
+uint16_t SSD1306::_window(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1) {
+	uint8_t clean = ~((0xFF << page0) & (0xFF >> (7 - page1)));
+	uint8_t x, page;
+	for (x=x0; x<=x1; x++) {
+		_dirty[x] &= clean;
+	}
+	
+	// Same as hv_set_column_address(x0, x1) and hv_set_page_address(page0, page1)
+	uint8_t cmd[SSD1306_WINDOW_COST] = {0x21, (uint8_t)(x0 & 0x7F), (uint8_t)(x1 & 0x7F), 0x22, (uint8_t)(page0 & 0x07), (uint8_t)(page1 & 0x07)};
+	begin();
+	commands(cmd, sizeof(cmd));
+	for (page=page0; page<=page1; page++) {
+		for (x=x0; x<=x1; x++) {
+			data(_compose(x, page));
+		}
+	}
+	end();
+	return SSD1306_WINDOW_COST + (uint16_t)(x1-x0+1)*(page1-page0+1);
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include <string.h>
+#include "telemetry.hpp"
+#include "uart.hpp"
+#include "adc.hpp"
+
+static telemetry_stats_t stats;
+
+/** Drops the bytes of a frame up to the next sync byte in them and keeps the rest, which is the
+ * start of the next frame when bytes of this one were lost
+ @param n Bytes of the frame, set to the bytes kept
+ @return 1 if a sync byte was found
+*/
+static uint8_t resync(uint8_t *frame, uint8_t &n) {
+	for (uint8_t i=0; i<n; i++) {
+		if (frame[i] == TELEMETRY_SYNC) {
+			n -= i + 1;
+			memmove(frame, frame + i + 1, n);
+			return 1;
+		}
+	}
+	n = 0;
+	return 0;
+}
+
+uint8_t telemetrySend(uint8_t type, const void *record, uint8_t len) {
+	uint8_t frame[TELEMETRY_MAX_RECORD + 4];
+	const uint8_t *r = (const uint8_t*) record;
+	uint8_t crc = telemetryCRC(telemetryCRC(0, type), len);
+	frame[0] = TELEMETRY_SYNC;
+	frame[1] = type;
+	frame[2] = len;
+	for (uint8_t i=0; i<len; i++) {
+		frame[3+i] = r[i];
+		crc = telemetryCRC(crc, r[i]);
+	}
+	frame[3+len] = crc;
+	
+	if (!uartWrite(frame, len + 4)) {
+		stats.dropped++;
+		return 0;
+	}
+	stats.sent++;
+	return 1;
+}
+
+uint8_t telemetryReceive(void *record, uint8_t *len) {
+	// Frame being received: type, length, record and CRC after the sync byte
+	static uint8_t frame[TELEMETRY_MAX_RECORD + 3];
+	static uint8_t n = 0, synced = 0;
+	uint8_t b;
+	while (uartRead(&b)) {
+		if (!synced) {
+			synced = b == TELEMETRY_SYNC;
+			n = 0;
+			continue;
+		}
+		frame[n++] = b;
+		// A lost byte breaks the frame and takes the following bytes for its own, which may hold
+		// the next frame: a broken frame is looked at again from its next sync byte
+		while (synced && n >= 2) {
+			uint8_t end = frame[1] + 2; // The CRC
+			if (frame[1] <= TELEMETRY_MAX_RECORD) {
+				if (n <= end)
+					break;
+				uint8_t crc = 0;
+				for (uint8_t i=0; i<end; i++)
+					crc = telemetryCRC(crc, frame[i]);
+				if (crc == frame[end]) {
+					stats.received++;
+					*len = frame[1];
+					uint8_t *r = (uint8_t*) record;
+					for (uint8_t i=0; i<*len; i++)
+						r[i] = frame[2+i];
+					uint8_t type = frame[0];
+					n -= end + 1;
+					memmove(frame, frame + end + 1, n);
+					synced = resync(frame, n);
+					return type;
+				}
+			}
+			stats.bad++;
+			synced = resync(frame, n);
+		}
+	}
+	return 0;
+}
+
+void telemetrySendProfile() {
+#ifdef PONG_PROFILE
+	telemetry_profile_t p;
+	for (uint8_t i=0; i<PROF_SECTIONS; i++) {
+		prof_stats_t s = profStats(i);
+		prof_time_t mean = s.count ? s.total / s.count : 0;
+		p.mean[i] = mean > 0xFFFF ? 0xFFFF : mean;
+		p.max[i] = s.max > 0xFFFF ? 0xFFFF : s.max;
+	}
+	// Mean of the reads since the last profile record, the sums subtracted like schedDuty does
+	static adc_latency_t last;
+	adc_latency_t l = adcLatency();
+	uint32_t reads = l.reads - last.reads, total = l.total - last.total;
+	last = l;
+	p.padLatency = reads ? total * CLOCK_ADC_CONVERSION_US / reads : 0;
+	p.padJitter = l.reads ? (l.max - l.min) * CLOCK_ADC_CONVERSION_US : 0;
+	telemetrySend(TELEMETRY_PROFILE, &p, sizeof(p));
+#endif
+}
+
+telemetry_stats_t telemetryStats() {
+	return stats;
+}
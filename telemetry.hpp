@@ -0,0 +1,117 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <avr/io.h>
+#include "profiler.hpp"
+
+/* Records sent over the UART, and with PONG_LINK also received from the other board. A frame is
+ *   TELEMETRY_SYNC, type, length, <length bytes of record>, CRC8
+ * where the CRC8 (polynomial 0x07, initial value 0) covers type, length and the record.
+ * Records are packed and little endian. A frame which does not fit in the transmit
+ * buffer is dropped whole, so a reader only ever sees complete frames or gaps.
+ */
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_MAX_RECORD 32
+
+// Game state is sent every TELEMETRY_PERIOD main loop passes, profiler counters every TELEMETRY_PROFILE_PERIOD state records
+#define TELEMETRY_PERIOD 8
+#define TELEMETRY_PROFILE_PERIOD 16
+
+enum {
+	TELEMETRY_STATE = 1,
+	TELEMETRY_PROFILE = 2,
+	TELEMETRY_LINK = 3,
+};
+
+typedef struct __attribute__((packed)) {
+	uint16_t tick;      // Scheduler tick, wraps
+	int16_t ballX, ballY; // Position of the first ball, in 1/Balls::PIX_SCL pixels
+	int16_t velX, velY;
+	int16_t spin;
+	uint8_t padY[2];    // Left, right
+	int8_t padVel[2];
+	uint8_t score[2];
+	uint8_t duty;       // Percent of the time the CPU was awake since the last state record
+} telemetry_state_t;
+
+typedef struct __attribute__((packed)) {
+	uint16_t mean[PROF_SECTIONS]; // Profiler units (cycles, ns on the host), saturated
+	uint16_t max[PROF_SECTIONS];
+	uint16_t padLatency; // Mean latency of the pad input since the last profile record in microseconds, see adcLatency
+	uint16_t padJitter;  // Its max - min since the start
+} telemetry_profile_t;
+
+#define TELEMETRY_LINK_INPUTS 8 // Most pad inputs in a link record
+
+/** Pad inputs and acknowledgement sent between the boards with PONG_LINK, see link.hpp. Only the
+ * inputs which are sent are in the record, its length is 10 + the number of inputs.
+ */
+typedef struct __attribute__((packed)) {
+	uint16_t sum;       // Fletcher-16 of the rest of the record, see telemetryLinkSum
+	uint16_t first;     // Tick of input[0]
+	uint16_t ack;       // The sender has the receiver's inputs of all ticks before this one
+	uint16_t checkTick; // Tick of the sender's newest confirmed state
+	uint16_t check;     // Its checksum, see Pong::checksum
+	uint8_t input[TELEMETRY_LINK_INPUTS]; // The sender's pad, readADC/ADC_OVERSAMPLE
+} telemetry_link_t;
+
+typedef struct {
+	uint16_t sent;
+	uint16_t dropped;  // Frames which did not fit in the transmit buffer
+	uint16_t received; // Frames with a good CRC taken by telemetryReceive
+	uint16_t bad;      // Frames started but dropped for their length or CRC
+} telemetry_stats_t;
+
+/** Adds a byte to a CRC8 with polynomial 0x07 */
+static inline uint8_t telemetryCRC(uint8_t crc, uint8_t b) {
+	crc ^= b;
+	for (uint8_t i=0; i<8; i++)
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	return crc;
+}
+
+/** Adds a byte to a Fletcher-16 sum. The sums are kept modulo 255 by adding the carry back in,
+ * which needs no division.
+ */
+static inline void telemetryFletcher(uint8_t *sum, uint8_t b) {
+	uint16_t t = sum[0] + b;
+	sum[0] = (t & 0xFF) + (t >> 8);
+	t = sum[1] + sum[0];
+	sum[1] = (t & 0xFF) + (t >> 8);
+}
+
+/** Fletcher-16 of a link record after its sum. The CRC8 of the frame lets about one in 256
+ * broken frames through, and a single one of them makes the boards play different games.
+ @param len Length of the record
+*/
+static inline uint16_t telemetryLinkSum(const telemetry_link_t *f, uint8_t len) {
+	const uint8_t *r = (const uint8_t*) f;
+	uint8_t sum[2] = {0, 0};
+	for (uint8_t i=sizeof(f->sum); i<len; i++)
+		telemetryFletcher(sum, r[i]);
+	return sum[1] << 8 | sum[0];
+}
+
+/** Frames a record and queues it on the UART, or drops it if the buffer is too full
+ @param type One of TELEMETRY_*
+ @param record The record
+ @param len Size of the record, at most TELEMETRY_MAX_RECORD
+ @return 1 if queued, 0 if dropped
+*/
+uint8_t telemetrySend(uint8_t type, const void *record, uint8_t len);
+
+/** Takes the bytes received by the UART and returns the next complete frame with a good CRC.
+ * Bytes which do not make up a frame are skipped. Never waits.
+ @param record Set to the record, has room for TELEMETRY_MAX_RECORD bytes
+ @param len Set to the size of the record
+ @return Type of the frame, 0 if no complete frame was received yet
+*/
+uint8_t telemetryReceive(void *record, uint8_t *len);
+
+/** Sends the mean and max of the profiler sections. Does nothing without PONG_PROFILE. */
+void telemetrySendProfile();
+
+/** Gets a copy of the frame counters */
+telemetry_stats_t telemetryStats();
+
+#endif /* __TELEMETRY_H__ */
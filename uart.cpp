@@ -0,0 +1,81 @@
+#include "uart.hpp"
+#include "bitops.h"
+
+#define UART_TX_MASK (UART_TX_LEN-1)
+#define UART_RX_MASK (UART_RX_LEN-1)
+
+static uint8_t tx[UART_TX_LEN];
+static volatile uint8_t txHead = 0; // Next byte to write, only changed by uartWrite
+static volatile uint8_t txTail = 0; // Next byte to send, only changed by the ISR
+static uint8_t rx[UART_RX_LEN];
+static volatile uint8_t rxHead = 0; // Next byte to receive, only changed by the ISR
+static volatile uint8_t rxTail = 0; // Next byte to read, only changed by uartRead
+
+/** ISR on USART data register empty. Sends the next byte, and turns itself off when the buffer is empty.
+**/
+ISR(USART_UDRE_vect) {
+	uint8_t tail = txTail;
+	if (tail == txHead) {
+		UCSR0B &= ~BV(UDRIE0);
+		return;
+	}
+	UDR0 = tx[tail];
+	txTail = (tail + 1) & UART_TX_MASK;
+}
+
+/** ISR on USART receive complete. Puts the byte in the buffer, or drops it if the buffer is full.
+**/
+ISR(USART_RX_vect) {
+	uint8_t b = UDR0; // Reading UDR0 clears the interrupt, also when the byte is dropped
+	uint8_t head = rxHead;
+	uint8_t next = (head + 1) & UART_RX_MASK;
+	if (next == rxTail)
+		return;
+	rx[head] = b;
+	rxHead = next;
+}
+
+void initUART() {
+	UBRR0H = UART_UBRR >> 8;
+	UBRR0L = UART_UBRR & 0xFF;
+	UCSR0A = BV(U2X0);
+	UCSR0C = BV(UCSZ01) | BV(UCSZ00); // 8 data bits, no parity, 1 stop bit
+	UCSR0B = BV(TXEN0);
+}
+
+uint8_t uartFree() {
+	return UART_TX_MASK - ((txHead - txTail) & UART_TX_MASK);
+}
+
+uint8_t uartWrite(const uint8_t *data, uint8_t len) {
+	if (len > uartFree())
+		return 0;
+	uint8_t head = txHead;
+	for (uint8_t i=0; i<len; i++) {
+		tx[head] = data[i];
+		head = (head + 1) & UART_TX_MASK;
+	}
+	txHead = head;
+	
+	// UCSR0B is outside the bit addressable I/O space, so this is a read-modify-write the ISR can
+	// interrupt. The ISR only clears UDRIE0 when the buffer is empty, which it no longer is, so
+	// setting it again from a stale read is right either way.
+	UCSR0B |= BV(UDRIE0);
+	return 1;
+}
+
+void uartStartReceiver() {
+	uint8_t sreg_save = SREG;
+	cli(); // UCSR0B is shared with USART_UDRE_vect, see uartWrite
+	UCSR0B |= BV(RXEN0) | BV(RXCIE0);
+	SREG = sreg_save;
+}
+
+uint8_t uartRead(uint8_t *b) {
+	uint8_t tail = rxTail;
+	if (tail == rxHead)
+		return 0;
+	*b = rx[tail];
+	rxTail = (tail + 1) & UART_RX_MASK;
+	return 1;
+}
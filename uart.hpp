@@ -0,0 +1,41 @@
+#ifndef __UART_H__
+#define __UART_H__
+
+#include "clock.hpp"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define UART_BAUD 9600
+#define UART_UBRR ((F_CPU/4/UART_BAUD - 1)/2) // Rounded, for double speed (U2X0)
+// Baud rate UART_UBRR gives, which the receiver has to be within 2% of
+#define UART_REAL_BAUD (F_CPU/8/(UART_UBRR + 1))
+
+static_assert(UART_REAL_BAUD*50 >= UART_BAUD*49 && UART_REAL_BAUD*50 <= UART_BAUD*51, "UART_BAUD is more than 2% off at this F_CPU");
+#define UART_TX_LEN 64 // Size of the transmit ring buffer, a power of two
+#define UART_RX_LEN 32 // Size of the receive ring buffer, a power of two
+
+/** Starts the transmitter, 8N1 at UART_BAUD. Bytes are sent from USART_UDRE_vect. */
+void initUART();
+
+/** Queues bytes to send, either all of them or none if they do not fit. Never waits.
+ @param data Bytes to send
+ @param len Number of bytes, less than UART_TX_LEN
+ @return 1 if the bytes were queued, 0 if the buffer was too full
+*/
+uint8_t uartWrite(const uint8_t *data, uint8_t len);
+
+/** Number of bytes which can be queued right now */
+uint8_t uartFree();
+
+/** Starts the receiver. Bytes are put in the receive buffer by USART_RX_vect, and dropped
+ * while it is full. Can be called with interrupts on.
+*/
+void uartStartReceiver();
+
+/** Takes the next received byte. Never waits.
+ @param b Set to the byte
+ @return 1 if a byte was taken, 0 if none was received
+*/
+uint8_t uartRead(uint8_t *b);
+
+#endif /* __UART_H__ */